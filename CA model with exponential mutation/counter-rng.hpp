@@ -0,0 +1,182 @@
+/*
+  CounterRng is a counter-based random number generator (Philox4x32-10,
+  Salmon et al. 2011). The n-th 64-bit number of a stream is a fixed
+  function of the seed, the stream number and n, computed without any
+  hidden state. Hence:
+
+  - any number of independent streams can be created at no cost, in
+    any order and on any thread, and always give the same numbers;
+  - a stream can jump ahead by any distance in constant time, so one
+    stream can also be split into consecutive substreams;
+  - the whole state is three integers, easy to save and restore.
+
+  It satisfies the UniformRandomBitGenerator requirements and can be
+  used with the distributions of <random>.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  seed: the seed of the simulation.
+
+  stream: the number of the stream. Different streams of the same seed
+  are independent.
+
+  ------------------------------------------------------------
+  Methods:
+
+  operator()(): the next 64-bit random number of the stream.
+
+  seed(seed,stream): restarts the generator as if newly constructed.
+
+  fill(out,n): writes the next n numbers to out[0..n-1]. Same numbers
+  as n calls to operator()(), but computed in a loop without
+  dependencies between iterations, which the compiler can vectorize.
+
+  discard(n): skips the next n numbers.
+
+  os << rng, is >> rng: save and restore the state as text.
+
+  get_state(state), set_state(state): the same with the three integers
+  of the state, for binary files.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#ifndef COUNTER_RNG
+#define COUNTER_RNG
+
+class CounterRng {
+
+private:
+  std::uint64_t key;
+  std::uint64_t stream_id;
+  std::uint64_t position; // Index of the next number in the stream
+
+  // The last block computed, which holds the numbers 2*cached and 2*cached+1
+  std::uint64_t cached;
+  std::uint64_t block[2];
+
+  inline static void philox(const std::uint64_t key,const std::uint64_t stream,const std::uint64_t n,std::uint64_t out[2]);
+
+public:
+  typedef std::uint64_t result_type;
+
+  inline explicit CounterRng(const std::uint64_t a_seed = 0,const std::uint64_t stream = 0);
+
+  static constexpr result_type min() {return 0;}
+  static constexpr result_type max() {return ~static_cast<result_type>(0);}
+  inline result_type operator()();
+
+  inline void seed(const std::uint64_t a_seed,const std::uint64_t stream = 0);
+  inline void fill(result_type* out,const std::size_t n);
+  inline void discard(const unsigned long long n);
+
+  inline void get_state(std::uint64_t state[3]) const;
+  inline void set_state(const std::uint64_t state[3]);
+
+  friend inline std::ostream& operator<<(std::ostream& os,const CounterRng& rng);
+  friend inline std::istream& operator>>(std::istream& is,CounterRng& rng);
+};
+
+CounterRng::CounterRng(const std::uint64_t a_seed,const std::uint64_t stream)
+{
+  seed(a_seed,stream);
+}
+
+void CounterRng::seed(const std::uint64_t a_seed,const std::uint64_t stream)
+{
+  key = a_seed;
+  stream_id = stream;
+  position = 0;
+  cached = ~static_cast<std::uint64_t>(0);
+}
+
+/* Ten rounds of Philox4x32 on the counter (n,stream), giving the
+   numbers 2n and 2n+1 of the stream */
+void CounterRng::philox(const std::uint64_t key,const std::uint64_t stream,const std::uint64_t n,std::uint64_t out[2])
+{
+  std::uint32_t c0 = static_cast<std::uint32_t>(n);
+  std::uint32_t c1 = static_cast<std::uint32_t>(n >> 32);
+  std::uint32_t c2 = static_cast<std::uint32_t>(stream);
+  std::uint32_t c3 = static_cast<std::uint32_t>(stream >> 32);
+  std::uint32_t k0 = static_cast<std::uint32_t>(key);
+  std::uint32_t k1 = static_cast<std::uint32_t>(key >> 32);
+  for(unsigned round = 0; round < 10; ++round){
+    const std::uint64_t p0 = static_cast<std::uint64_t>(0xD2511F53u) * c0;
+    const std::uint64_t p1 = static_cast<std::uint64_t>(0xCD9E8D57u) * c2;
+    const std::uint32_t n0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+    const std::uint32_t n2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+    c1 = static_cast<std::uint32_t>(p1);
+    c3 = static_cast<std::uint32_t>(p0);
+    c0 = n0;
+    c2 = n2;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
+  }
+  out[0] = (static_cast<std::uint64_t>(c1) << 32) | c0;
+  out[1] = (static_cast<std::uint64_t>(c3) << 32) | c2;
+}
+
+CounterRng::result_type CounterRng::operator()()
+{
+  const std::uint64_t n = position / 2;
+  if(n != cached){
+    philox(key,stream_id,n,block);
+    cached = n;
+  }
+  return block[position++ % 2];
+}
+
+void CounterRng::fill(result_type* out,const std::size_t n)
+{
+  std::size_t i = 0;
+  if(n > 0 && position % 2 == 1)
+    out[i++] = (*this)();
+
+  const std::uint64_t first = position / 2;
+  const std::size_t n_block = (n - i) / 2;
+  for(std::size_t b = 0; b < n_block; ++b)
+    philox(key,stream_id,first + b,out + i + 2*b);
+  i += 2*n_block;
+  position += 2*n_block;
+
+  if(i < n)
+    out[i] = (*this)();
+}
+
+void CounterRng::discard(const unsigned long long n)
+{
+  position += n;
+}
+
+void CounterRng::get_state(std::uint64_t state[3]) const
+{
+  state[0] = key;
+  state[1] = stream_id;
+  state[2] = position;
+}
+
+void CounterRng::set_state(const std::uint64_t state[3])
+{
+  seed(state[0],state[1]);
+  discard(state[2]);
+}
+
+std::ostream& operator<<(std::ostream& os,const CounterRng& rng)
+{
+  return os << rng.key << " " << rng.stream_id << " " << rng.position;
+}
+
+std::istream& operator>>(std::istream& is,CounterRng& rng)
+{
+  std::uint64_t key, stream, position;
+  if(is >> key >> stream >> position){
+    rng.seed(key,stream);
+    rng.discard(position);
+  }
+  return is;
+}
+
+#endif
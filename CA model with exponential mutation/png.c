@@ -100,6 +100,59 @@ int BlockPNG(unsigned char *a,int nRow,int nCol,int c)
   return (0);
 }
 
+/* My addition: the name of the next frame, as BlockPNG() would write
+   it, into name[512]. The frame counter is incremented, so frames that are encoded
+   later by WritePNG() keep their order. */
+void NextPNGName(char *name)
+{
+  sprintf(name,"%s/%.5d.png",dirname,nframes);
+  nframes++;
+}
+
+/* My addition: a version of BlockPNG() that writes to the file "name"
+   with the given zlib compression level (0-9) and set of row filters
+   (PNG_FILTER_* flags). It does not use any global variable but the
+   colors, so several frames can be written at the same time by
+   different threads. */
+int WritePNG(const char *name,const unsigned char *a,int nRow,int nCol,int c,int level,int filters)
+{
+  int i,j,k;
+  FILE *fp;
+  png_structp png;
+  png_infop info;
+  png_bytep row;
+  fp = fopen(name,"wb");
+  if (fp == NULL) {
+    fprintf(stderr,"WritePNG(): Error, cannot open %s\n",name);
+    return (1);
+  }
+  png = png_create_write_struct(PNG_LIBPNG_VER_STRING,
+   (png_voidp)NULL, (png_error_ptr)NULL, (png_error_ptr)NULL);
+  info = png_create_info_struct (png);
+  png_init_io(png, fp);
+  png_set_compression_level(png, level);
+  png_set_filter(png, PNG_FILTER_TYPE_BASE, filters);
+  png_set_IHDR(png, info, nCol, nRow,
+    8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+    PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+  png_write_info(png,info);
+  row = (png_bytep)malloc(3*nCol);
+  for (i=0; i < nRow; i++) {
+    for (j=0; j < nCol; j++) {
+      k = i*nCol + j;
+      row[j*3] = userCol[c+a[k]][1];
+      row[j*3 + 1] = userCol[c+a[k]][2];
+      row[j*3 + 2] = userCol[c+a[k]][3];
+    }
+    png_write_row(png, row);
+  }
+  free(row);
+  png_write_end(png, info);
+  png_destroy_write_struct(&png,&info);
+  fclose(fp);
+  return (0);
+}
+
 int ClosePNG()
 {
   FILE *fp;
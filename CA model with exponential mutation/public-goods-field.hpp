@@ -0,0 +1,309 @@
+/*
+  PublicGoodsField keeps, for every cell of a grid, the sum of the
+  public goods produced by the live cells in its neighborhood, the
+  (2*radius+1)x(2*radius+1) square centred on it (wrapped boundaries,
+  centre cell excluded), together with the number of those live cells.
+  This is exactly what Automaton::cal_average_k() computes by scanning
+  the neighbors, but here the sums are maintained incrementally.
+
+  The sums are kept separately along the rows and the columns: for
+  every cell, the sum over the 2*radius+1 cells of its row centred on
+  it. A change of a cell updates the 2*radius+1 row sums that contain
+  it, and the sum over the neighborhood of a cell adds the 2*radius+1
+  row sums of its column, so both cost O(radius) instead of
+  O(radius^2) for a scan.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  nrow, ncol: the size of the grid it follows.
+
+  radius: the radius of the neighborhood, 2 (the 5x5 neighborhood) by
+  default. The neighborhood must fit in the grid:
+  2*radius+1 <= nrow, ncol.
+
+  The first argument to the template, <G>, is the grid type, either
+  CA2D<Automaton> or AutomatonPlanes. G::cell(row,col) must give
+  access to get_state() (0 means dead) and get_k(), the amount of
+  public goods the cell produces, and G must offer box_sums() (see
+  cellular-automata.hpp). The second one, <Source>, tells which
+  live cells produce the goods summed: Source::has(cell) must be true
+  for them. AllLive takes every live cell; in the competition models,
+  DolSystem takes the cells of the DOL system (states 1 and 2) and
+  SystemP those of system p (states 3 and 4), so that one field per
+  system gives the contributions of each system to a neighborhood.
+
+  ------------------------------------------------------------
+  Methods:
+
+  rebuild(ca):
+
+  Recomputes the whole field from scratch, in time independent of the
+  radius. Call it after the grid has been initialized or loaded, and
+  after any bulk change that is not reported cell by cell.
+
+  refresh(ca,row,col):
+
+  Must be called after the cell at (row,col) has been born, has
+  died, has been swapped or has changed its traits. It compares the
+  cell with the contribution registered for it and applies the
+  difference to the row sums that contain (row,col).
+  Calling it on an unchanged cell costs nothing.
+
+  average_k(row,col):
+
+  Returns the average public goods concentration perceived by the
+  cell at (row,col), or 0 when no neighbor is alive.
+
+  get_k_sum(row,col), get_n_alive(row,col): the sum of the k of the
+  neighbors of (row,col) taken by Source, and their number.
+
+  get_radius(): the radius of the neighborhood.
+
+  prefetch(row,col): starts loading into the cache the sums that
+  average_k(row,col) reads (see CA2D::prefetch()).
+
+  tolerance(): the bound on the difference between average_k() and
+  cal_average_k() (see Precision).
+
+  ------------------------------------------------------------
+  Precision:
+
+  The sums are kept in 64-bit fixed point, so they never drift no
+  matter how many events are applied. A k is at most 1, and the number
+  of fractional bits is the largest one, up to MAX_FRACTION_BITS, with
+  which the k of a whole neighborhood cannot overflow: 52 up to a
+  radius of 22, fewer beyond. Each k is rounded to the nearest
+  multiple of 2^-fraction_bits when registered, hence average_k()
+  differs from the floating point scan of cal_average_k() by at most
+  K_TOLERANCE per cell of the neighborhood (the rounding of every k
+  plus the summation error of the scan itself).
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#ifndef PUBLIC_GOODS_FIELD
+#define PUBLIC_GOODS_FIELD
+
+// Every live cell produces public goods
+struct AllLive {
+  template <class C> static bool has(const C& cell) {return cell.get_state() != 0;}
+};
+
+// Cells of the DOL system of the competition models
+struct DolSystem {
+  template <class C> static bool has(const C& cell) {return cell.get_state() == 1 || cell.get_state() == 2;}
+};
+
+// Cells of system p of the competition models
+struct SystemP {
+  template <class C> static bool has(const C& cell) {return cell.get_state() == 3 || cell.get_state() == 4;}
+};
+
+template <class G,class Source = AllLive> class PublicGoodsField {
+
+private:
+  unsigned nrow;
+  unsigned ncol;
+  unsigned radius;
+  int fraction_bits;
+
+  /* Per-cell sums over the 2*radius+1 cells of its row centred on it,
+     the cell included: k in fixed point, and the number of cells taken
+     by Source. */
+  std::vector<std::int64_t> row_k;
+  std::vector<unsigned short> row_alive;
+
+  /* The contribution currently registered for each cell, in fixed
+     point. NOT_ALIVE means that the cell is registered as dead. */
+  std::vector<std::int64_t> k_own;
+
+  // Values summed by rebuild()
+  struct KOf {
+    const PublicGoodsField* field;
+    template <class C> std::int64_t operator()(const C& cell) const {
+      const std::int64_t k = field->contribution(cell);
+      return (k != NOT_ALIVE) ? k : 0;
+    }
+  };
+  struct AliveOf {
+    template <class C> unsigned short operator()(const C& cell) const {return Source::has(cell) ? 1 : 0;}
+  };
+
+  inline unsigned offset(const unsigned row,const unsigned col) const;
+  inline unsigned wrap_row(const int row) const;
+  inline unsigned wrap_col(const int col) const;
+  template <class C> std::int64_t contribution(const C& cell) const;
+  inline void apply(const unsigned row,const unsigned col,const std::int64_t d_k,const int d_alive);
+  inline void window(const unsigned row,const unsigned col,std::int64_t& k_sum,unsigned& n_alive) const;
+
+public:
+  static const int MAX_FRACTION_BITS = 52;
+  static const std::int64_t NOT_ALIVE = -1;
+  static constexpr double K_TOLERANCE = 4e-15;
+
+  inline PublicGoodsField(const unsigned a_nrow,const unsigned a_ncol,const unsigned a_radius = 2);
+
+  inline void rebuild(const G& ca);
+  inline void refresh(const G& ca,const unsigned row,const unsigned col);
+
+  inline double average_k(const unsigned row,const unsigned col) const;
+  inline double get_k_sum(const unsigned row,const unsigned col) const;
+  inline unsigned get_n_alive(const unsigned row,const unsigned col) const;
+  inline void prefetch(const unsigned row,const unsigned col) const;
+  unsigned get_radius() const {return radius;}
+  double tolerance() const {return K_TOLERANCE * (2*radius+1) * (2*radius+1);}
+};
+
+template <class G,class Source> const int PublicGoodsField<G,Source>::MAX_FRACTION_BITS;
+template <class G,class Source> const std::int64_t PublicGoodsField<G,Source>::NOT_ALIVE;
+template <class G,class Source> constexpr double PublicGoodsField<G,Source>::K_TOLERANCE;
+
+template <class G,class Source> PublicGoodsField<G,Source>::PublicGoodsField(const unsigned a_nrow,const unsigned a_ncol,const unsigned a_radius)
+  : nrow(a_nrow),
+    ncol(a_ncol),
+    radius(a_radius),
+    fraction_bits(MAX_FRACTION_BITS),
+    row_k(a_nrow*a_ncol,0),
+    row_alive(a_nrow*a_ncol,0),
+    k_own(a_nrow*a_ncol,NOT_ALIVE)
+{
+  if(nrow==0 || ncol==0){
+    std::cerr << "PublicGoodsField() Error: nrow=ncol=0 is not allowed." << std::endl;
+  }
+  if(2*radius+1 > nrow || 2*radius+1 > ncol){
+    std::cerr << "PublicGoodsField() Error: a neighborhood of radius " << radius << " does not fit in a " << nrow << "x" << ncol << " grid." << std::endl;
+    exit(-1);
+  }
+  // The sum of the k of a whole neighborhood must stay below 2^63
+  const std::uint64_t n_cell = static_cast<std::uint64_t>(2*radius+1) * (2*radius+1);
+  while(fraction_bits > 0 && n_cell >= (std::uint64_t(1) << (63 - fraction_bits)))
+    --fraction_bits;
+}
+
+/* The field does not have boundaries, so rows and columns [1,n] are
+   mapped to [0,n-1]. */
+template <class G,class Source> unsigned PublicGoodsField<G,Source>::offset(const unsigned row,const unsigned col) const
+{
+  return (row-1)*ncol + (col-1);
+}
+
+/* Same wrapping as the scan in cal_average_k() */
+template <class G,class Source> unsigned PublicGoodsField<G,Source>::wrap_row(const int row) const
+{
+  if(row <= 0) return nrow + row;
+  if(row > static_cast<int>(nrow)) return row - nrow;
+  return row;
+}
+
+template <class G,class Source> unsigned PublicGoodsField<G,Source>::wrap_col(const int col) const
+{
+  if(col <= 0) return ncol + col;
+  if(col > static_cast<int>(ncol)) return col - ncol;
+  return col;
+}
+
+template <class G,class Source> template <class C> std::int64_t PublicGoodsField<G,Source>::contribution(const C& cell) const
+{
+  if(!Source::has(cell))
+    return NOT_ALIVE;
+  return static_cast<std::int64_t>(std::llround(std::ldexp(cell.get_k(),fraction_bits)));
+}
+
+/* Add d_k and d_alive to the row sums that contain (row,col): those of
+   the 2*radius+1 cells of its row centred on it. */
+template <class G,class Source> void PublicGoodsField<G,Source>::apply(const unsigned row,const unsigned col,const std::int64_t d_k,const int d_alive)
+{
+  const unsigned first = offset(row,1);
+  for(int c = static_cast<int>(col) - static_cast<int>(radius); c <= static_cast<int>(col + radius); ++c){
+    const unsigned ind = first + wrap_col(c) - 1;
+    row_k[ind] += d_k;
+    row_alive[ind] = static_cast<unsigned short>(row_alive[ind] + d_alive);
+  }
+}
+
+// Sums over the neighborhood of (row,col): its column of row sums, without the cell itself
+template <class G,class Source> void PublicGoodsField<G,Source>::window(const unsigned row,const unsigned col,std::int64_t& k_sum,unsigned& n_alive) const
+{
+  k_sum = 0;
+  n_alive = 0;
+  for(int r = static_cast<int>(row) - static_cast<int>(radius); r <= static_cast<int>(row + radius); ++r){
+    const unsigned ind = offset(wrap_row(r),col);
+    k_sum += row_k[ind];
+    n_alive += row_alive[ind];
+  }
+  const std::int64_t k = k_own[offset(row,col)];
+  if(k != NOT_ALIVE){
+    k_sum -= k;
+    n_alive -= 1;
+  }
+}
+
+// The same entries as window(), without reading them
+template <class G,class Source> void PublicGoodsField<G,Source>::prefetch(const unsigned row,const unsigned col) const
+{
+  for(int r = static_cast<int>(row) - static_cast<int>(radius); r <= static_cast<int>(row + radius); ++r){
+    const unsigned ind = offset(wrap_row(r),col);
+    __builtin_prefetch(&row_k[ind]);
+    __builtin_prefetch(&row_alive[ind]);
+  }
+  __builtin_prefetch(&k_own[offset(row,col)]);
+}
+
+template <class G,class Source> void PublicGoodsField<G,Source>::rebuild(const G& ca)
+{
+  for(unsigned row = 1; row <= nrow; ++row){
+    for(unsigned col = 1; col <= ncol; ++col){
+      k_own[offset(row,col)] = contribution(ca.cell(row,col));
+    }
+  }
+  KOf k_of = {this};
+  ca.box_sums(k_of,0,radius,row_k);
+  ca.box_sums(AliveOf(),0,radius,row_alive);
+}
+
+template <class G,class Source> void PublicGoodsField<G,Source>::refresh(const G& ca,const unsigned row,const unsigned col)
+{
+  const unsigned ind = offset(row,col);
+  const std::int64_t k_old = k_own[ind];
+  const std::int64_t k_new = contribution(ca.cell(row,col));
+  if(k_new == k_old)
+    return;
+
+  const std::int64_t d_k = ((k_new != NOT_ALIVE) ? k_new : 0) - ((k_old != NOT_ALIVE) ? k_old : 0);
+  const int d_alive = ((k_new != NOT_ALIVE) ? 1 : 0) - ((k_old != NOT_ALIVE) ? 1 : 0);
+  k_own[ind] = k_new;
+  apply(row,col,d_k,d_alive);
+}
+
+template <class G,class Source> double PublicGoodsField<G,Source>::average_k(const unsigned row,const unsigned col) const
+{
+  std::int64_t k_sum;
+  unsigned n_alive;
+  window(row,col,k_sum,n_alive);
+  if(n_alive == 0)
+    return 0.0;
+  return std::ldexp(static_cast<double>(k_sum),-fraction_bits) / n_alive;
+}
+
+template <class G,class Source> double PublicGoodsField<G,Source>::get_k_sum(const unsigned row,const unsigned col) const
+{
+  std::int64_t k_sum;
+  unsigned n_alive;
+  window(row,col,k_sum,n_alive);
+  return std::ldexp(static_cast<double>(k_sum),-fraction_bits);
+}
+
+template <class G,class Source> unsigned PublicGoodsField<G,Source>::get_n_alive(const unsigned row,const unsigned col) const
+{
+  std::int64_t k_sum;
+  unsigned n_alive;
+  window(row,col,k_sum,n_alive);
+  return n_alive;
+}
+
+#endif
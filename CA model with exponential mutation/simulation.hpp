@@ -0,0 +1,236 @@
+/*
+  Simulation is one run of the model, with everything it depends on:
+  the grid, the structures maintained alongside it, the random number
+  generator and the output files. Nothing is shared between two
+  simulations, so several of them can run at the same time in
+  different threads (see sweep.cpp), as long as they write to
+  different directories and do not record a movie.
+
+  The template parameter Model sets the variant of the model: its
+  mutation kernel, its killings, where the offspring and the public
+  goods of a cell come from and which systems compete on the grid (see
+  model-policies.hpp). The six model folders hold identical copies of
+  this engine, and simulation.cpp builds it for the Model of its folder
+  (see model.hpp), so a change of the engine is copied as is to all of
+  them.
+
+  RunConfig holds the settings of a run: the parameters, the engine and
+  the other command line options. Its constructor gives the defaults,
+  the run time and the rescan interval being those of the Model.
+  read_run_options() fills it from the --key=value options; the values
+  already in it are the defaults.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  config: settings of the run. When config.input_file is a checkpoint
+  (see checkpoint.hpp), the run goes on from it, otherwise the grid is
+  loaded from it (or drawn at random when it is empty).
+
+  ------------------------------------------------------------
+  Methods:
+
+  run():
+
+  Run the model until the end of the run time, an extinction, or a
+  stop asked for by SIGTERM or the wall clock budget, and return which
+  of FINISHED, EXTINCT or STOPPED ended it. The cell states are saved
+  whatever ended the run, and a stopped run also writes a checkpoint
+  it can be resumed from.
+
+  get_time():
+
+  The time step at which run() returned.
+
+  memory_report():
+
+  Where the grid is in memory: the pages it got and their placement,
+  as set by --pages and --numa.
+
+  ------------------------------------------------------------
+  Signals:
+
+  on_signal() is the handler for SIGUSR1 (a checkpoint of every running
+  simulation at the start of its next step) and SIGTERM (a checkpoint,
+  then every simulation stops). The requests are kept in lock-free
+  atomics so that the handler can set them from any thread.
+*/
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "automaton.hpp"
+#include "cash-display.hpp"
+#include "public-goods-field.hpp"
+#include "site-set.hpp"
+#include "active-sites.hpp"
+#include "options.hpp"
+#include "propensity-tree.hpp"
+#include "counter-rng.hpp"
+#include "tile-schedule.hpp"
+#include "sweep-draws.hpp"
+#include "population-stats.hpp"
+#include "checkpoint.hpp"
+#include "time-series.hpp"
+#include "model-policies.hpp"
+
+#ifndef SIMULATION
+#define SIMULATION
+
+struct RunConfig {
+  RunConfig();
+  double move = 0.0; //Move_chance
+  double mutation = 0.0;
+  double death = 0.0;
+  unsigned seed = 0;
+  unsigned runtime = 0;
+  std::string input_file; //Grid or checkpoint to start from, empty: random grid
+  std::string out_dir; //Directory of the output files, empty: the current directory
+  std::string engine = "sweep";
+  unsigned long n_threads = 0; // 0: OpenMP default
+  unsigned long tile_side = 16;
+  unsigned long rescan_interval = 1000000; // Steps between two scans of the grid for the statistics
+  unsigned long prefetch = 0; // Draws ahead of the sweep engine whose cells are prefetched, 0: none
+  unsigned long png_threads = 1; // 0: frames are written by the simulation thread
+  unsigned long png_queue = 2;
+  unsigned long png_level = 6;
+  std::string png_filter = "all";
+  std::string movie = "png"; // png: a directory of png files, mov: a single file (see movie-export), none: no movie
+  unsigned long movie_key = 100; // Frames between two key frames of the mov file
+  unsigned long checkpoint_every = 10000; // Steps between two checkpoints, 0: none
+  unsigned long checkpoint_level = 0; // zlib level of the checkpoints, 0: not compressed
+  unsigned long max_wall_seconds = 0; // Stop with a checkpoint after this time, 0: no limit
+  std::chrono::steady_clock::time_point wall_deadline;
+  std::string series = "csv"; // csv: text files, bin: binary records and a json schema (see time-series.hpp)
+  unsigned long n_row = 100; // Size of the grid
+  unsigned long n_col = 100;
+  std::vector<unsigned long> kill_box; // Box killed by BoxKill: first row, first col, last row, last col, empty: the middle half of the grid
+  unsigned long radius = 2; // Radius of the neighborhood sharing the public goods, 2: 5x5
+  std::string mean_k = "grid-sample"; // How a well-mixed cell perceives the mean k: grid-sample, exact or live-sample
+  PagePolicy grid_pages; // Pages and NUMA placement of the grid (see page-block.hpp)
+};
+
+/* Sides of the grid. The cells are indexed by unsigned offsets, and
+   the display by int coordinates, so the grid with its boundary must
+   hold fewer than 2^31 cells; the neighborhood of the public goods,
+   5x5 at the default radius, must fit in the torus. */
+const unsigned long MIN_SIDE = 5;
+const unsigned long MAX_SIDE = 32768;
+
+// Options of a run, as written after the positional arguments in a usage message
+extern const std::string RUN_OPTIONS_USAGE;
+
+bool read_run_options(const Options& options, RunConfig& config);
+
+// Requests of the signal handler, checked at the start of every time step
+extern std::atomic<unsigned> checkpoint_requests;
+extern std::atomic<bool> stop_requested;
+void on_signal(int signum);
+
+template <class Model> class Simulation {
+public:
+  enum Status {FINISHED, EXTINCT, STOPPED};
+
+private:
+  typedef typename Model::Mutation Mutation;
+  typedef typename Model::Perturbation Perturbation;
+  typedef typename Model::Neighborhood Neighborhood;
+  typedef typename Model::Systems Systems;
+
+  RunConfig config;
+  std::string settings; //Written in the checkpoints
+  ModelParams params; //Move chance and mortality of this run
+  double t; //Δt
+  unsigned n_row;
+  unsigned n_col;
+
+  /* Random number generator. It uses stream 0 of the seed, the
+     parallel engine the following ones. */
+  CounterRng random;
+  std::uniform_real_distribution<double> uniform;
+
+  AutomatonGrid* ca_curr;
+  CashDisplay* display_p;
+  PublicGoodsField<AutomatonGrid>* pg_field;
+  ActiveSites<AutomatonGrid>* active_sites;
+  PropensityTree* ssa_tree;
+  TileSchedule* tiles;
+  PopulationStats<AutomatonGrid, ByState>* state_stats;
+  PopulationStats<AutomatonGrid, ByAncestor>* ancestor_stats; // When Systems::LINEAGE
+  // Sums of the k of the DOL system and of system p around every cell, when Neighborhood::CONTRIBUTIONS
+  PublicGoodsField<AutomatonGrid, DolSystem>* dol_k;
+  PublicGoodsField<AutomatonGrid, SystemP>* p_k;
+  SiteSet* live_cells; // Index (row-1)*n_col+(col-1) of every live cell, when Perturbation::LIVE_INDEX or for the live-sample mean k
+  TimeSeriesWriter cellOutFile;
+  TimeSeriesWriter ancestorOutFile;
+  TimeSeriesWriter contributionOutFile;
+  WellMixed::MeanK mean_k_mode; // When Neighborhood is WellMixed
+  /* Contributions of the step: the shares of the DOL system (0) and of
+     system p (1) in the public goods around the parents of the other
+     system, summed over its births */
+  double contribution[2];
+  unsigned n_births[2];
+  SweepDraws draws; //Random numbers of a sweep, drawn in blocks
+  unsigned movie_interval; //Steps between two frames
+  unsigned start_time;
+  unsigned time;
+  unsigned checkpoints_seen; //Value of checkpoint_requests at the last checkpoint
+  unsigned lastKillTime; //Time step of the last killing
+  unsigned box[4]; //Box killed by BoxKill: first row, first col, last row, last col
+
+  Simulation(const Simulation&);
+  void operator=(const Simulation&);
+
+  std::string output_path(const std::string& name) const;
+  void saveCheckpoint(const std::string& filename);
+  unsigned loadCheckpoint(const CheckpointReader& checkpoint);
+  void openOutput(TimeSeriesWriter& outFile, const std::string& name, const std::string& columns, const std::string& types, const CheckpointReader* resume, const std::string& section);
+  template <class RNG> double average_k_at(Local, unsigned row, unsigned col, RNG& rng);
+  template <class RNG> double average_k_at(WellMixed, unsigned row, unsigned col, RNG& rng);
+  template <class RNG> bool draw_parent(Local, unsigned row, unsigned col, unsigned nei, RNG& rng, unsigned& neirow, unsigned& neicol);
+  template <class RNG> bool draw_parent(WellMixed, unsigned row, unsigned col, unsigned nei, RNG& rng, unsigned& neirow, unsigned& neicol);
+  double neighbor_k(unsigned row, unsigned col, double k_sum[2]);
+  double system_k(unsigned row, unsigned col, double k_sum[2]);
+  double contribution_share(unsigned row, unsigned col, unsigned system);
+  void count_contribution(unsigned row, unsigned col);
+  double propensity(unsigned row, unsigned col);
+  void restore_live_cells(const std::vector<unsigned>& order);
+  void ssa_refresh(unsigned row, unsigned col);
+  void track_live(unsigned row, unsigned col);
+  void rebuild_live_cells();
+  void count_cell(unsigned row, unsigned col);
+  void rescan_stats();
+  void cell_changed(unsigned row, unsigned col);
+  void cells_swapped(unsigned row, unsigned col, unsigned row2, unsigned col2);
+  void prefetch_draw(unsigned row, unsigned col, unsigned nei);
+  void kill_cell(unsigned row, unsigned col);
+  void move_cell(unsigned row, unsigned col, unsigned nei);
+  template <class RNG> void birth_cell(unsigned row, unsigned col, unsigned neirow, unsigned neicol, unsigned state, double M, RNG& rng);
+  template <class RNG> void update_site(unsigned row, unsigned col, double p, unsigned nei, double mutation, RNG& rng);
+  template <class RNG> void update_site(unsigned row, unsigned col, double mutation, RNG& rng);
+  void sweep_active(unsigned long n_draws, double mutation);
+  unsigned offspring_state(unsigned row, unsigned col);
+  void ssa_advance(double duration, double mutation);
+  void sweep_tiles(unsigned long step, std::uint64_t seed, double mutation);
+  unsigned char cell_color(OneSystem, int row, int col);
+  unsigned char cell_color(TwoSystems, int row, int col);
+  void write_lineage();
+  void write_cells(OneSystem);
+  void write_cells(TwoSystems);
+  void write_contributions();
+  void perturb(NoKill) {}
+  void perturb(BoxKill);
+  void perturb(RandomKill);
+
+public:
+  Simulation(const RunConfig& a_config);
+  ~Simulation();
+  Status run();
+  unsigned get_time() const {return time;}
+  std::string memory_report() const {return ca_curr->memory_report();}
+};
+
+#endif
@@ -1,16 +1,16 @@
 #include "automaton.hpp"
 
-
+//Default Constructor 
 Automaton::Automaton()
-    : state(0), da(0.5), db(0.5), death(), ka(0.5), kb(0.5), Move_chance() {
+    : state(0), da(0.5), db(0.5), ka(0.5), kb(0.5) {
 }
-
+//Copy constructor
 Automaton::Automaton(const Automaton& other)
     : state(other.state), da(other.da), db(other.db), ka(other.ka), 
       kb(other.kb) {
 }
 
-//assignment operation
+//Assignment operation
 Automaton& Automaton::operator=(const Automaton& other) {
     if (this != &other) { 
         state = other.state;
@@ -22,17 +22,15 @@ Automaton& Automaton::operator=(const Automaton& other) {
     return *this; 
 }
 
+
 //Calculation of average public goods
-double Automaton::cal_average_k(CA2D<Automaton>* ca, unsigned row, unsigned col) {
+double Automaton::cal_average_k(AutomatonGrid* ca, unsigned row, unsigned col, unsigned radius) {
     double total_k = 0.0;
     unsigned n_alive = 0;
-    int nrow = ca->get_nrow();
-    int ncol = ca->get_ncol();
-
-    int initial_row = row - 2;
-    int initial_col = col - 2;
-    int end_row = row + 2;
-    int end_col = col + 2;
+    int initial_row = row - radius;
+    int initial_col = col - radius;
+    int end_row = row + radius;
+    int end_col = col + radius;
 
     //test output
     //std::cout << "Center cell row: " << row << ", col: " << col << std::endl;
@@ -40,23 +38,8 @@ double Automaton::cal_average_k(CA2D<Automaton>* ca, unsigned row, unsigned col)
     for (int r = initial_row; r <= end_row; ++r) {
         for (int c = initial_col; c <= end_col; ++c) {
             // Periodic boundary conditions
-           int wrapped_r, wrapped_c;
-            
-            if (r <= 0) {
-                wrapped_r = nrow + r;
-            } else if (r > nrow) {
-                wrapped_r = r - nrow;
-            } else {
-                wrapped_r = r;
-            }
-
-            if (c <= 0) {
-                wrapped_c = ncol + c;
-            } else if (c > ncol) {
-                wrapped_c = c - ncol;
-            } else {
-                wrapped_c = c;
-            }
+            unsigned wrapped_r = ca->wrap_row(r);
+            unsigned wrapped_c = ca->wrap_col(c);
 
             // Skip Centre Cell
             if (wrapped_r == row && wrapped_c == col) {
@@ -66,14 +49,20 @@ double Automaton::cal_average_k(CA2D<Automaton>* ca, unsigned row, unsigned col)
             //std::cout << "Checking cell at wrapped_r: " << wrapped_r << ", wrapped_c: " << wrapped_c << std::endl;
 
             const auto& neighbor = ca->cell(wrapped_r, wrapped_c);
-            if (neighbor.state == 1) {
-                total_k += neighbor.ka;
+            if (neighbor.get_state() == 1) {
+                total_k += neighbor.get_ka();
                 n_alive += 1;
                 //std::cout << "State: 1, ka: " << self.ka << std::endl;
-            } else if (neighbor.state == 2) {
-                total_k += neighbor.kb;
+            } else if (neighbor.get_state() == 2) {
+                total_k += neighbor.get_kb();
                 n_alive += 1;
                 //std::cout << "State: 2, kb: " << self.kb << std::endl;
+            } else if (neighbor.get_state() == 3) {
+                total_k += neighbor.get_ka();
+                n_alive += 1;
+            } else if (neighbor.get_state() == 4) {
+                total_k += neighbor.get_kb();
+                n_alive += 1;
             }
         }
     }
@@ -81,40 +70,7 @@ double Automaton::cal_average_k(CA2D<Automaton>* ca, unsigned row, unsigned col)
     return n_alive > 0 ? total_k / n_alive : 0.0;
 }
 
-//linear mutation
-double Automaton::mutate_trait(double p) {
-    static std::normal_distribution<double> dist(0.0, var); 
-
-    double delta = dist(ran_gen::random); 
-    double p_prime = p + delta;
-
-    // Ensure p_prime stays within [0, 1] by reflecting it back into the range
-    if (p_prime < 0.0) {
-        p_prime = -p_prime;  // Reflect negative values to positive
-    }
-    
-    if (p_prime > 1.0) {
-        p_prime = 2.0 - p_prime;  // Reflect values greater than 1 back into the range
-    }
-
-    // Final check to clamp within bounds in case of edge cases
-    if (p_prime > 1.0) {
-        p_prime = 1.0;
-    } else if (p_prime < 0.0) {
-        p_prime = 0.0;
-    }
-
-    return p_prime; 
-}
-
-
-void Automaton::set_mutation(double Newda, double Newka,double Newdb, double Newkb) {
-    da = this->mutate_trait(Newda);
-    ka = this->mutate_trait(Newka);
-    db = this->mutate_trait(Newdb);
-    kb = this->mutate_trait(Newkb);
-}
-
+//Trait values remain the same
 void Automaton::set_keep(double Newda, double Newka,double Newdb, double Newkb) {
     da = Newda;
     ka = Newka;
@@ -122,16 +78,18 @@ void Automaton::set_keep(double Newda, double Newka,double Newdb, double Newkb)
     kb = Newkb;
 }
 
-void Automaton::set_move(double Move) {
-    Move_chance = Move;
-}
-
-void Automaton::set_death(double dea) {
-    death = dea;
+int Automaton::get_state() const{
+    return state;
 }
 
-int Automaton::get_state() {
-    return state;
+//Public goods produced by the cell, states 1/3 produce ka and states 2/4 produce kb
+double Automaton::get_k() const{
+    if (state == 1 || state == 3) {
+        return ka;
+    } else if (state == 2 || state == 4) {
+        return kb;
+    }
+    return 0.0;
 }
 
 void Automaton::set_state(unsigned newone) {
@@ -146,12 +104,9 @@ int Automaton::get_ances () const{
     return ances;
 }
 
-double Automaton::get_death () const{
-    return death;
-}
-
-double Automaton::get_move () const{
-    return Move_chance;
+void Automaton::set_d(double newda,double newdb) {
+    da = newda;
+    db = newdb;
 }
 
 double Automaton::get_da() const{
@@ -170,7 +125,6 @@ double Automaton::get_kb() const{
     return kb;
 }
 
-
 // Implementing Friendly Functions
 void swap(Automaton& first, Automaton& second) noexcept {
     std::swap(first.state, second.state);
@@ -179,3 +133,25 @@ void swap(Automaton& first, Automaton& second) noexcept {
     std::swap(first.db, second.db);
     std::swap(first.kb, second.kb);
 }
+
+//Every plane starts with the values of a default constructed Automaton
+AutomatonPlanes::AutomatonPlanes(const unsigned a_nrow,const unsigned a_ncol,const PagePolicy& policy,const unsigned a_halo)
+    : state(a_nrow, a_ncol, policy, a_halo), ances(a_nrow, a_ncol, policy, a_halo), da(a_nrow, a_ncol, policy, a_halo), ka(a_nrow, a_ncol, policy, a_halo),
+      db(a_nrow, a_ncol, policy, a_halo), kb(a_nrow, a_ncol, policy, a_halo) {
+    const Automaton proto;
+    for (std::size_t ind = 0; ind < state.size(); ++ind) {
+        state.cell(ind) = proto.get_state();
+        ances.cell(ind) = 0;
+        da.cell(ind) = proto.get_da();
+        ka.cell(ind) = proto.get_ka();
+        db.cell(ind) = proto.get_db();
+        kb.cell(ind) = proto.get_kb();
+    }
+}
+
+// One line per plane, see CA2D::memory_report()
+std::string AutomatonPlanes::memory_report() const {
+    return "state " + state.memory_report() + "; ances " + ances.memory_report()
+        + "; da " + da.memory_report() + "; ka " + ka.memory_report()
+        + "; db " + db.memory_report() + "; kb " + kb.memory_report();
+}
@@ -1,44 +1,62 @@
 #include "cellular-automata.hpp"
+#include "counter-rng.hpp"
 #include <random>
 #include <cmath> 
 #include <string>
+#include <vector>
 #include <iostream>
 #ifndef AUTOMATON
 #define AUTOMATON
-namespace ran_gen{
-extern std::seed_seq seed;
-extern std::mt19937_64 random;
-}
+class Automaton;
+class AutomatonPlanes;
 
-class Automaton {
-private:
-  int ances;
-  int state;//State 0: dead cell. State 1: live cell type A. State 2: live cell type B.
-  double da = 0.5;//Differentiation probability
-  double db =  0.5;//Differentiation probability
+/* The grid type used by the simulation. By default it is an array of
+   Automaton objects. Compile with -DCA_SOA to store the grid as a
+   structure of arrays (see AutomatonPlanes below). */
+#ifdef CA_SOA
+typedef AutomatonPlanes AutomatonGrid;
+#else
+typedef CA2D<Automaton> AutomatonGrid;
+#endif
+
+/* Traits are stored in double precision. Compile with
+   -DCA_FLOAT_TRAITS to store them in single precision: an automaton
+   then takes about half the memory, but the traits are rounded, so the
+   runs no longer reproduce those of the double precision build. */
+#ifdef CA_FLOAT_TRAITS
+typedef float Trait;
+#else
+typedef double Trait;
+#endif
+
+/* Parameters that are the same for every automaton of a run */
+struct ModelParams {
   double death = 0.1; //Fixed mortality
-  double ka =  0.5;// Quantity of public property production
-  double kb = 0.5;// Quantity of public property production
-  const double var = 0.002; //standard deviation of variable variation
   double Move_chance = 0.5;//Random move probability
+};
+
+class Automaton {
+private:
+  unsigned char ances;//Ancestor tag, followed when the model tracks the lineage (see model-policies.hpp)
+  unsigned char state;//State 0: dead cell. State 1: live cell type A. State 2: live cell type B. States 3 and 4: types A and B of system p.
+  Trait da = 0.5;//Differentiation probability
+  Trait db =  0.5;//Differentiation probability
+  Trait ka =  0.5;// Quantity of public property production
+  Trait kb = 0.5;// Quantity of public property production
 
 public:
-  double cal_average_k(CA2D<Automaton>* ca,unsigned row, unsigned col);//Calculate the current average concentration of public property around the cell
-  double mutate_trait(double p);//variable mutation function
-  void set_mutation(double Newda, double Newka,double Newdb, double Newkb);
+  static double cal_average_k(AutomatonGrid* ca,unsigned row, unsigned col, unsigned radius = 2);//Calculate the current average concentration of public property in the (2*radius+1)^2 neighborhood of the cell
   void set_keep(double Newda, double Newka,double Newdb, double Newkb);
-  void set_move(double Move);
-  void set_death(double dea);
   int get_ances() const;
   double get_da() const;
   double get_ka() const;
   double get_db() const;
   double get_kb() const;
-  double get_death() const;
-  double get_move() const;
-  int get_state();
+  int get_state() const;
+  double get_k() const;//Public goods produced by the cell (0 when dead)
   void set_state(unsigned newone);
   void set_ances(unsigned newone);
+  void set_d(double newda,double newdb);
 
   // Declare friend functions to implement position swapping
   friend void swap(Automaton& first, Automaton& second) noexcept;
@@ -49,4 +67,139 @@ public:
   Automaton(); // Default constructor
 };
 
+/* AutomatonPlanes stores the automata as a structure of arrays. The
+   state and the ancestor tag live in byte planes and every trait in
+   its own Trait plane. Each plane is a CA2D of the same size, so a
+   cell has the same index() in all of them.
+
+   Cells are accessed through AutomatonRef, a small handle that offers
+   the same methods as Automaton. Loops over the grid therefore only
+   read the planes they need. All the planes are allocated with the
+   same PagePolicy and the same boundaries, and memory_report() tells
+   where each one is. */
+class AutomatonRef;
+
+class AutomatonPlanes {
+  friend class AutomatonRef;
+  friend void swap(AutomatonRef first, AutomatonRef second) noexcept;
+private:
+  CA2D<unsigned char> state;
+  CA2D<unsigned char> ances;
+  CA2D<Trait> da;
+  CA2D<Trait> ka;
+  CA2D<Trait> db;
+  CA2D<Trait> kb;
+
+  AutomatonPlanes(const AutomatonPlanes& rhs);
+  void operator=(const AutomatonPlanes& rhs);
+
+public:
+  AutomatonPlanes(const unsigned a_nrow,const unsigned a_ncol,const PagePolicy& policy = PagePolicy(),const unsigned a_halo = 1);
+  std::string memory_report() const;
+  unsigned get_nrow() const {return state.get_nrow();}
+  unsigned get_ncol() const {return state.get_ncol();}
+  unsigned index(const unsigned row,const unsigned col) const {return state.index(row,col);}
+  // The planes read first by an update: the state, and the k of the public goods
+  void prefetch(const unsigned ind) const {state.prefetch(ind); ka.prefetch(ind); kb.prefetch(ind);}
+  inline AutomatonRef cell(const unsigned row,const unsigned col);
+  inline const AutomatonRef cell(const unsigned row,const unsigned col) const;
+  inline AutomatonRef cell(const unsigned ind);
+  inline const AutomatonRef cell(const unsigned ind) const;
+  void xy_neigh_wrap(const unsigned row,const unsigned col,const unsigned nei,unsigned& nei_row,unsigned& nei_col) const {state.xy_neigh_wrap(row,col,nei,nei_row,nei_col);}
+  unsigned wrap_row(const int row) const {return state.wrap_row(row);}
+  unsigned wrap_col(const int col) const {return state.wrap_col(col);}
+  unsigned get_halo() const {return state.get_halo();}
+  inline void refresh_halo();
+  inline void mirror(const unsigned row,const unsigned col);
+  unsigned index_near(const unsigned row,const unsigned col,const unsigned nei) const {return state.index_near(row,col,nei);}
+  template <class F,class S> void box_sums(const F& value,const unsigned row_radius,const unsigned col_radius,std::vector<S>& sums) const {periodic_box_sums(*this,value,row_radius,col_radius,sums);}
+};
+
+class AutomatonRef {
+private:
+  AutomatonPlanes* planes;
+  unsigned ind;
+
+public:
+  AutomatonRef(AutomatonPlanes* a_planes,const unsigned a_ind) : planes(a_planes), ind(a_ind) {}
+
+  double cal_average_k(AutomatonGrid* ca,unsigned row, unsigned col, unsigned radius = 2) const {return Automaton::cal_average_k(ca,row,col,radius);}
+  void set_keep(double Newda, double Newka,double Newdb, double Newkb) {
+    planes->da.cell(ind) = Newda;
+    planes->ka.cell(ind) = Newka;
+    planes->db.cell(ind) = Newdb;
+    planes->kb.cell(ind) = Newkb;
+  }
+  int get_ances() const {return planes->ances.cell(ind);}
+  double get_da() const {return planes->da.cell(ind);}
+  double get_ka() const {return planes->ka.cell(ind);}
+  double get_db() const {return planes->db.cell(ind);}
+  double get_kb() const {return planes->kb.cell(ind);}
+  int get_state() const {return planes->state.cell(ind);}
+  double get_k() const {
+    const int state = get_state();
+    if (state == 1 || state == 3) {
+      return get_ka();
+    } else if (state == 2 || state == 4) {
+      return get_kb();
+    }
+    return 0.0;
+  }
+  void set_state(unsigned newone) {planes->state.cell(ind) = newone;}
+  void set_ances(unsigned newone) {planes->ances.cell(ind) = newone;}
+  void set_d(double newda,double newdb) {
+    planes->da.cell(ind) = newda;
+    planes->db.cell(ind) = newdb;
+  }
+
+  // Same members as swap(Automaton&,Automaton&)
+  friend void swap(AutomatonRef first, AutomatonRef second) noexcept {
+    std::swap(first.planes->state.cell(first.ind), second.planes->state.cell(second.ind));
+    std::swap(first.planes->da.cell(first.ind), second.planes->da.cell(second.ind));
+    std::swap(first.planes->ka.cell(first.ind), second.planes->ka.cell(second.ind));
+    std::swap(first.planes->db.cell(first.ind), second.planes->db.cell(second.ind));
+    std::swap(first.planes->kb.cell(first.ind), second.planes->kb.cell(second.ind));
+  }
+};
+
+AutomatonRef AutomatonPlanes::cell(const unsigned row,const unsigned col)
+{
+  return AutomatonRef(this,index(row,col));
+}
+
+const AutomatonRef AutomatonPlanes::cell(const unsigned row,const unsigned col) const
+{
+  return AutomatonRef(const_cast<AutomatonPlanes*>(this),index(row,col));
+}
+
+AutomatonRef AutomatonPlanes::cell(const unsigned ind)
+{
+  return AutomatonRef(this,ind);
+}
+
+const AutomatonRef AutomatonPlanes::cell(const unsigned ind) const
+{
+  return AutomatonRef(const_cast<AutomatonPlanes*>(this),ind);
+}
+
+void AutomatonPlanes::refresh_halo()
+{
+  state.refresh_halo();
+  ances.refresh_halo();
+  da.refresh_halo();
+  ka.refresh_halo();
+  db.refresh_halo();
+  kb.refresh_halo();
+}
+
+void AutomatonPlanes::mirror(const unsigned row,const unsigned col)
+{
+  state.mirror(row,col);
+  ances.mirror(row,col);
+  da.mirror(row,col);
+  ka.mirror(row,col);
+  db.mirror(row,col);
+  kb.mirror(row,col);
+}
+
 #endif
@@ -7,6 +7,8 @@
 
 #include "cash.h"
 #include "assert.hpp"
+#include "png-writer.hpp"
+#include "movie-recorder.hpp"
 
 #ifndef CASH_DISPLAY
 #define CASH_DISPLAY
@@ -90,6 +92,22 @@ class CashDisplay{
   /* The color of the magins between panels */
   unsigned char margin_color;
 
+public:
+  /* A painter gives the color of the pixel (row,col) of a panel. */
+  typedef std::function<unsigned char(int row,int col)> Painter;
+
+private:
+  /* The painter of each panel, empty for the panels that are set by
+     put_pixel() or put_histogram(). */
+  std::vector<Painter> painters;
+
+  /* The background encoder of the png files, or nullptr when
+     draw_png() writes them itself. */
+  PngWriter* png_writer;
+
+  /* The single-file movie written by draw_movie(), or nullptr. */
+  MovieRecorder* movie_recorder;
+
 public:
   /* Constructer must get basic information about window and panels. The
      size of _panel_info is identical to the number of panels. Each
@@ -111,9 +129,20 @@ public:
   void color_yellow2red(const unsigned char color_ind_begin,const unsigned char length);
   
   /* To open a window and make a png directory. They call OpenWindow()
-     and OpenPNG() of CASH  */
+     and OpenPNG() of CASH. The png files are encoded by n_threads
+     background threads with queue_size frame buffers, compression
+     level and row filter (see PngWriter). With n_threads=0,
+     draw_png() writes every file itself before returning. */
   void open_window(const std::string& window_title="cash_display");
-  void open_png(const std::string& directory_name="cash_movie");
+  void open_png(const std::string& directory_name="cash_movie",const unsigned n_threads=1,const unsigned queue_size=2,const int level=6,const std::string& filter="all");
+
+  /* To open a single-file movie instead of a png directory. Every frame
+     drawn by draw_movie() is appended to the file, storing only what
+     changed since the previous frame, with a key frame every
+     key_interval frames, compressed with the zlib level (see
+     MovieRecorder). The file is completed when the display is
+     destroyed. movie-export turns it into png files or a y4m video. */
+  void open_movie(const std::string& file_name="cash_movie.mov",const unsigned key_interval=100,const int level=1);
 
   /* To get information about the number of panels. This is identical to
      the size of _panel_info given to the constructer.  */
@@ -132,6 +161,15 @@ public:
      window. */
   inline void put_pixel(const unsigned panel_ind,const int row,const int col,const unsigned char color);
 
+  /* Lazy alternative to put_pixel(). The painter of a panel is only
+     called, for every pixel of the panel, when the window or a png file
+     is drawn, so a simulation does not need to copy its state into the
+     panel at every step when frames are rare. An empty painter turns
+     the lazy mode of the panel off. render() calls the painters without
+     drawing anything. */
+  void set_painter(const unsigned panel_ind,const Painter& painter);
+  void render();
+
 
   /* This draws a histgram in a panel with given frequencies. The height
      of bars is specified by the argument "frequency". The maximum
@@ -146,9 +184,10 @@ public:
   inline void put_histogram(const unsigned panel_ind,const std::vector<double>& frequencies,const double max_y,const unsigned char color_of_blank,const unsigned char color_of_background,const unsigned char color_of_bar);
 
   /* This actually draw pixels into window and png. Pixels should be
-     specified by put_pixel(). */
+     specified by put_pixel() or by a painter. */
   inline void draw_window();
   inline void draw_png();
+  void draw_movie();
   /* This fills the whole window by setting every pixel to the specified
      color. This can also be used to modify the color of the margins
      between the panels. */
@@ -231,12 +270,20 @@ unsigned char& CashDisplay::data_at(const unsigned panel_ind,const unsigned row,
 
 void CashDisplay::draw_window()
 {
+  render();
   BlockDisplay(data,window_row,window_col,0,0,0);
 }
 
 void CashDisplay::draw_png()
 {
-  BlockPNG(data,window_row,window_col,0);
+  render();
+  if(png_writer){
+    char name[512];
+    NextPNGName(name);
+    png_writer->submit(name,data,window_row,window_col,0);
+  }else{
+    BlockPNG(data,window_row,window_col,0);
+  }
 }
 
 void CashDisplay::put_histogram(const unsigned panel_ind,const std::vector<double>& frequencies,const double max_y,const unsigned char color_of_blank,const unsigned char color_of_background,const unsigned char color_of_bar)
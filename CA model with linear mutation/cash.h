@@ -182,6 +182,8 @@ void ResetNFrames(const int new_nframes);
 int OpenPNG(char*,int,int);
 int PlanePNG(TYPE**,int);
 int BlockPNG(unsigned char*,int,int,int);
+void NextPNGName(char*);
+int WritePNG(const char*,const unsigned char*,int,int,int,int,int);
 int ClosePNG();
 
 /***********************************************movie*/
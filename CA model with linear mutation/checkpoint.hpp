@@ -0,0 +1,358 @@
+/*
+  CheckpointWriter and CheckpointReader save and load the complete
+  state of a simulation in a binary file, so that a run can be resumed
+  exactly where it stopped.
+
+  A checkpoint is a header followed by named sections, each an array of
+  numbers or a text. What a model puts in the sections is up to the
+  model; the header only identifies the model and the grid size, so
+  that a checkpoint is not loaded by the wrong program.
+
+  ------------------------------------------------------------
+  File format:
+
+  The numbers are in the byte order of the machine that wrote the file.
+
+  header: "CASHCKP\n", version (uint32), flags (uint32, COMPRESSED),
+  the name of the model (32 chars, padded with zeros), nrow, ncol
+  (uint32), the size of the body (uint64) and the size it takes in the
+  file (uint64).
+
+  body: the sections one after the other, compressed by zlib as a
+  whole if COMPRESSED. A section is its name (16 chars, padded with
+  zeros), the size of its data in bytes (uint64), then the data padded
+  with zeros to a multiple of 8 bytes, so that every section is
+  aligned in memory.
+
+  ------------------------------------------------------------
+  CheckpointWriter
+
+  Constructer:
+
+  model: the name of the model, at most 31 chars.
+
+  nrow, ncol: the size of the grid.
+
+  Methods:
+
+  add_value(name,value), add_values(name,values), add_text(name,text):
+
+  Add a section holding one number, an array of numbers (std::vector)
+  or a text. The names must be different and at most 15 chars long.
+
+  write(file_name,level):
+
+  Writes the checkpoint, compressed with the zlib level (1 to 9) or not
+  compressed if level is 0. The file is first written under another
+  name, then renamed: a crash while writing leaves the previous
+  checkpoint intact.
+
+  ------------------------------------------------------------
+  CheckpointReader
+
+  Constructer:
+
+  file_name: the checkpoint to read. The file is mapped into memory; an
+  uncompressed checkpoint is read in place, without copying it.
+
+  Methods:
+
+  is_checkpoint(file_name): static, whether the file starts like a
+  checkpoint (so that it is not a text file of cell states).
+
+  get_model(), get_n_row(), get_n_col(): as given to the writer.
+
+  has(name): whether there is a section of this name.
+
+  values<T>(name,n): the array of the section, and in n the number of
+  elements. The pointer is valid as long as the reader.
+
+  get_value<T>(name), get_values<T>(name), get_text(name): copies of the
+  section as written by add_value(), add_values() and add_text().
+
+  A missing section, a section of the wrong size, or a file that is not
+  a complete checkpoint, prints a message and terminates the program.
+*/
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef CHECKPOINT
+#define CHECKPOINT
+
+namespace CheckpointFile {
+  const char MAGIC[8] = {'C','A','S','H','C','K','P','\n'};
+  const std::uint32_t VERSION = 1;
+
+  const std::uint32_t COMPRESSED = 1;
+
+  const unsigned MODEL_SIZE = 32;
+  const unsigned NAME_SIZE = 16;
+  const unsigned HEADER_SIZE = 8 + 4 + 4 + MODEL_SIZE + 4 + 4 + 8 + 8;
+
+  struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+    char model[MODEL_SIZE];
+    std::uint32_t nrow;
+    std::uint32_t ncol;
+    std::uint64_t body_size;
+    std::uint64_t stored_size;
+  };
+
+  // Data sizes are rounded up to this to keep the sections aligned
+  const std::uint64_t ALIGN = 8;
+  inline std::uint64_t padded(const std::uint64_t size) {return (size + ALIGN - 1) / ALIGN * ALIGN;}
+}
+
+class CheckpointWriter {
+
+private:
+  CheckpointFile::Header header;
+  std::vector<unsigned char> body;
+  std::vector<std::string> names;
+
+  inline void add_section(const std::string& name,const void* data,const std::uint64_t size);
+
+public:
+  inline CheckpointWriter(const std::string& model,const unsigned nrow,const unsigned ncol);
+
+  template <class T> void add_value(const std::string& name,const T& value) {add_section(name,&value,sizeof(T));}
+  template <class T> void add_values(const std::string& name,const std::vector<T>& values) {add_section(name,values.data(),values.size()*sizeof(T));}
+  void add_text(const std::string& name,const std::string& text) {add_section(name,text.data(),text.size());}
+
+  inline void write(const std::string& file_name,const int level) const;
+};
+
+CheckpointWriter::CheckpointWriter(const std::string& model,const unsigned nrow,const unsigned ncol)
+{
+  if(model.size() >= CheckpointFile::MODEL_SIZE){
+    std::cerr << "CheckpointWriter() Error: the model name " << model << " is too long." << std::endl;
+    exit(-1);
+  }
+  std::memset(&header,0,sizeof(header));
+  std::memcpy(header.magic,CheckpointFile::MAGIC,sizeof(header.magic));
+  header.version = CheckpointFile::VERSION;
+  std::memcpy(header.model,model.data(),model.size());
+  header.nrow = nrow;
+  header.ncol = ncol;
+}
+
+void CheckpointWriter::add_section(const std::string& name,const void* data,const std::uint64_t size)
+{
+  if(name.empty() || name.size() >= CheckpointFile::NAME_SIZE){
+    std::cerr << "CheckpointWriter::add_section() Error: bad section name " << name << std::endl;
+    exit(-1);
+  }
+  for(const std::string& other : names){
+    if(other == name){
+      std::cerr << "CheckpointWriter::add_section() Error: section " << name << " added twice." << std::endl;
+      exit(-1);
+    }
+  }
+  names.push_back(name);
+
+  const std::size_t start = body.size();
+  body.resize(start + CheckpointFile::NAME_SIZE + sizeof(std::uint64_t) + CheckpointFile::padded(size),0);
+  std::memcpy(&body[start],name.data(),name.size());
+  std::memcpy(&body[start + CheckpointFile::NAME_SIZE],&size,sizeof(size));
+  if(size > 0)
+    std::memcpy(&body[start + CheckpointFile::NAME_SIZE + sizeof(size)],data,size);
+}
+
+void CheckpointWriter::write(const std::string& file_name,const int level) const
+{
+  if(level < 0 || level > 9){
+    std::cerr << "CheckpointWriter::write() Error: the compression level " << level << " is not between 0 and 9." << std::endl;
+    exit(-1);
+  }
+  CheckpointFile::Header out = header;
+  out.body_size = body.size();
+  std::vector<unsigned char> packed;
+  const unsigned char* stored = body.data();
+  out.stored_size = body.size();
+  if(level > 0){
+    uLongf packed_size = compressBound(body.size());
+    packed.resize(packed_size);
+    if(compress2(packed.data(),&packed_size,body.data(),body.size(),level) != Z_OK){
+      std::cerr << "CheckpointWriter::write() Error: compression failed." << std::endl;
+      exit(-1);
+    }
+    out.flags |= CheckpointFile::COMPRESSED;
+    out.stored_size = packed_size;
+    stored = packed.data();
+  }
+
+  const std::string temp_name = file_name + ".tmp";
+  std::ofstream file(temp_name.c_str(),std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&out),sizeof(out));
+  file.write(reinterpret_cast<const char*>(stored),out.stored_size);
+  file.close();
+  if(!file || std::rename(temp_name.c_str(),file_name.c_str()) != 0){
+    std::cerr << "CheckpointWriter::write() Error: cannot write " << file_name << std::endl;
+    exit(-1);
+  }
+}
+
+
+class CheckpointReader {
+
+private:
+  std::string file_name;
+  CheckpointFile::Header header;
+
+  // The mapped file, and the body: in the mapping or in unpacked
+  void* mapping;
+  std::size_t mapping_size;
+  std::vector<unsigned char> unpacked;
+  const unsigned char* body;
+
+  inline const unsigned char* find(const std::string& name,std::uint64_t& size) const;
+  inline void error(const std::string& message) const;
+
+  CheckpointReader(const CheckpointReader& rhs);
+  void operator=(const CheckpointReader& rhs);
+
+public:
+  inline explicit CheckpointReader(const std::string& a_file_name);
+  inline ~CheckpointReader();
+
+  inline static bool is_checkpoint(const std::string& file_name);
+
+  std::string get_model() const {return std::string(header.model,strnlen(header.model,CheckpointFile::MODEL_SIZE));}
+  unsigned get_n_row() const {return header.nrow;}
+  unsigned get_n_col() const {return header.ncol;}
+
+  bool has(const std::string& name) const {std::uint64_t size; return find(name,size) != nullptr;}
+  template <class T> inline const T* values(const std::string& name,std::size_t& n) const;
+  template <class T> inline T get_value(const std::string& name) const;
+  template <class T> inline std::vector<T> get_values(const std::string& name) const;
+  inline std::string get_text(const std::string& name) const;
+};
+
+static_assert(sizeof(CheckpointFile::Header) == CheckpointFile::HEADER_SIZE,"the checkpoint header must not be padded");
+
+CheckpointReader::CheckpointReader(const std::string& a_file_name)
+  : file_name(a_file_name),
+    mapping(MAP_FAILED),
+    mapping_size(0),
+    body(nullptr)
+{
+  const int fd = open(file_name.c_str(),O_RDONLY);
+  struct stat info;
+  if(fd < 0 || fstat(fd,&info) != 0)
+    error("cannot open the file");
+  mapping_size = info.st_size;
+  if(mapping_size < sizeof(header))
+    error("not a checkpoint");
+  mapping = mmap(nullptr,mapping_size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if(mapping == MAP_FAILED)
+    error("cannot map the file");
+
+  const unsigned char* data = static_cast<const unsigned char*>(mapping);
+  std::memcpy(&header,data,sizeof(header));
+  if(std::memcmp(header.magic,CheckpointFile::MAGIC,sizeof(header.magic)) != 0)
+    error("not a checkpoint");
+  if(header.version != CheckpointFile::VERSION)
+    error("unknown version");
+  if(header.stored_size != mapping_size - sizeof(header))
+    error("truncated file");
+
+  if(header.flags & CheckpointFile::COMPRESSED){
+    unpacked.resize(header.body_size);
+    uLongf unpacked_size = header.body_size;
+    if(uncompress(unpacked.data(),&unpacked_size,data + sizeof(header),header.stored_size) != Z_OK || unpacked_size != header.body_size)
+      error("bad compressed data");
+    body = unpacked.data();
+  }else{
+    if(header.body_size != header.stored_size)
+      error("bad header");
+    body = data + sizeof(header);
+  }
+}
+
+CheckpointReader::~CheckpointReader()
+{
+  if(mapping != MAP_FAILED)
+    munmap(mapping,mapping_size);
+}
+
+bool CheckpointReader::is_checkpoint(const std::string& file_name)
+{
+  std::ifstream file(file_name.c_str(),std::ios::binary);
+  char magic[sizeof(CheckpointFile::MAGIC)];
+  return file.read(magic,sizeof(magic)) && std::memcmp(magic,CheckpointFile::MAGIC,sizeof(magic)) == 0;
+}
+
+void CheckpointReader::error(const std::string& message) const
+{
+  std::cerr << "CheckpointReader Error: " << file_name << ": " << message << std::endl;
+  exit(-1);
+}
+
+// The data of the section name, nullptr if there is none
+const unsigned char* CheckpointReader::find(const std::string& name,std::uint64_t& size) const
+{
+  const std::uint64_t section_header = CheckpointFile::NAME_SIZE + sizeof(size);
+  std::uint64_t position = 0;
+  while(position + section_header <= header.body_size){
+    const char* section_name = reinterpret_cast<const char*>(body + position);
+    std::memcpy(&size,body + position + CheckpointFile::NAME_SIZE,sizeof(size));
+    if(size > header.body_size - position - section_header)
+      error("bad section size");
+    if(name == std::string(section_name,strnlen(section_name,CheckpointFile::NAME_SIZE)))
+      return body + position + section_header;
+    position += section_header + CheckpointFile::padded(size);
+  }
+  return nullptr;
+}
+
+template <class T> const T* CheckpointReader::values(const std::string& name,std::size_t& n) const
+{
+  std::uint64_t size;
+  const unsigned char* data = find(name,size);
+  if(data == nullptr)
+    error("no section " + name);
+  if(size % sizeof(T) != 0)
+    error("bad size of section " + name);
+  n = size / sizeof(T);
+  return reinterpret_cast<const T*>(data);
+}
+
+template <class T> T CheckpointReader::get_value(const std::string& name) const
+{
+  std::size_t n;
+  const T* data = values<T>(name,n);
+  if(n != 1)
+    error("section " + name + " is not a single value");
+  return *data;
+}
+
+template <class T> std::vector<T> CheckpointReader::get_values(const std::string& name) const
+{
+  std::size_t n;
+  const T* data = values<T>(name,n);
+  return std::vector<T>(data,data + n);
+}
+
+std::string CheckpointReader::get_text(const std::string& name) const
+{
+  std::size_t n;
+  const char* data = values<char>(name,n);
+  return std::string(data,n);
+}
+
+#endif
@@ -0,0 +1,116 @@
+/*
+  SiteSet is a set of cell indices that supports insertion, removal,
+  membership test and uniform random selection, all in constant
+  time. The members are kept densely in an array, and a second array
+  maps every index to its position in the dense array.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  n_index: indices must be smaller than this value.
+
+  ------------------------------------------------------------
+  Methods:
+
+  insert(ind), erase(ind):
+
+  Add or remove the index ind. Inserting a member or erasing a
+  non-member does nothing.
+
+  contains(ind): whether ind is a member.
+
+  size(): the number of members.
+
+  at(i): the i-th member, 0 <= i < size(). The order changes when
+  members are erased.
+
+  pick(rng): a member chosen uniformly at random. The set must not be
+  empty.
+
+  clear(): removes all members.
+*/
+
+#include <random>
+#include <vector>
+
+#ifndef SITESET
+#define SITESET
+
+class SiteSet {
+
+private:
+  /* Dense array of the members, and the position of each index in it
+     (NOT_MEMBER when the index is not in the set). */
+  std::vector<unsigned> members;
+  std::vector<unsigned> position;
+
+public:
+  static const unsigned NOT_MEMBER = ~0u;
+
+  inline explicit SiteSet(const unsigned n_index);
+
+  inline void insert(const unsigned ind);
+  inline void erase(const unsigned ind);
+  inline bool contains(const unsigned ind) const;
+  inline unsigned size() const;
+  inline unsigned at(const unsigned i) const;
+  template <class RNG> inline unsigned pick(RNG& rng) const;
+  inline void clear();
+};
+
+SiteSet::SiteSet(const unsigned n_index)
+  : position(n_index,static_cast<unsigned>(NOT_MEMBER))
+{
+  members.reserve(n_index);
+}
+
+void SiteSet::insert(const unsigned ind)
+{
+  if(position[ind] != NOT_MEMBER)
+    return;
+  position[ind] = members.size();
+  members.push_back(ind);
+}
+
+/* The last member takes the place of the erased one */
+void SiteSet::erase(const unsigned ind)
+{
+  const unsigned pos = position[ind];
+  if(pos == NOT_MEMBER)
+    return;
+  const unsigned last = members.back();
+  members[pos] = last;
+  position[last] = pos;
+  members.pop_back();
+  position[ind] = NOT_MEMBER;
+}
+
+bool SiteSet::contains(const unsigned ind) const
+{
+  return position[ind] != NOT_MEMBER;
+}
+
+unsigned SiteSet::size() const
+{
+  return members.size();
+}
+
+unsigned SiteSet::at(const unsigned i) const
+{
+  return members[i];
+}
+
+template <class RNG> unsigned SiteSet::pick(RNG& rng) const
+{
+  std::uniform_int_distribution<unsigned> dist(0,members.size()-1);
+  return members[dist(rng)];
+}
+
+void SiteSet::clear()
+{
+  for(unsigned i = 0; i < members.size(); ++i)
+    position[members[i]] = NOT_MEMBER;
+  members.clear();
+}
+
+#endif
@@ -0,0 +1,166 @@
+/* Library */
+#include <csignal> // for signal handling
+#include <sstream> // for std::stringstream
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <set>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <cerrno>
+#include <sys/stat.h> // mkdir()
+
+/* Other headers */
+#include "options.hpp"
+#include "simulation.hpp"
+#include "model.hpp"
+#include "work-pool.hpp"
+
+/* A parameter sweep: the runs listed in a grid file, one line
+   "Move_chance Mutation Death RandomSeed" per run ('#' starts a
+   comment), on a pool of threads in this process. Every run writes its
+   output files and its checkpoints to its own directory in the output
+   directory, with a file "status" once it is over. Running the sweep
+   again skips the runs that are over and resumes the stopped ones from
+   their last checkpoint, so a sweep interrupted by SIGTERM or the wall
+   clock budget goes on where it stopped. */
+
+// One line of the grid file
+struct Job {
+    double move;
+    double mutation;
+    double death;
+    unsigned seed;
+    std::string dir;
+};
+
+// Create a directory, unless it exists
+void makeDirectory(const std::string& dir) {
+    if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        std::cerr << "makeDirectory(): Error, cannot create " << dir << std::endl;
+        exit(-1);
+    }
+}
+
+// Read the runs of the grid file, and give each one a directory named after its parameters
+std::vector<Job> loadJobs(const std::string& filename, const std::string& out_dir) {
+    std::ifstream inFile(filename);
+    if (!inFile) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        exit(-1);
+    }
+    std::vector<Job> jobs;
+    std::set<std::string> dirs;
+    std::string line;
+    while (std::getline(inFile, line)) {
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+        std::stringstream ss(line);
+        Job job;
+        std::string rest;
+        if (!(ss >> job.move >> job.mutation >> job.death >> job.seed) || (ss >> rest)) {
+            std::cerr << "Error reading line: " << line << std::endl;
+            exit(-1);
+        }
+        std::stringstream dir;
+        dir << out_dir << "/move" << job.move << "_mutation" << job.mutation << "_death" << job.death << "_seed" << job.seed;
+        job.dir = dir.str();
+        if (!dirs.insert(job.dir).second) {
+            std::cerr << "loadJobs(): Error, the run " << line << " is listed twice" << std::endl;
+            exit(-1);
+        }
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+// First word of the status file of a run, empty when the run is not over
+std::string readStatus(const std::string& dir) {
+    std::ifstream inFile(dir + "/status");
+    std::string status;
+    inFile >> status;
+    return status;
+}
+
+int main(int argc, char** argv)
+{
+    // Optional --key=value arguments, removed from argv
+    Options options(argc, argv);
+    unsigned long n_workers = options.get_unsigned("workers", std::thread::hardware_concurrency());
+    std::string out_dir = options.get("out", "sweep-runs");
+    /* The display and the png writer are shared by the whole process,
+       so the runs of a sweep record no movie, and the parallel engine
+       uses one thread per run unless told otherwise. */
+    RunConfig defaults;
+    defaults.movie = "none";
+    defaults.n_threads = 1;
+    if (!read_run_options(options, defaults)) {
+        return 1;
+    }
+    if (defaults.movie != "none") {
+        std::cerr << "The runs of a sweep cannot record a movie (expected --movie=none)" << std::endl;
+        return 1;
+    }
+
+    // The run time is on the command line, unless the model has a fixed one (see model-policies.hpp)
+    const bool read_runtime = (Model::Systems::RUNTIME == 0);
+    if (argc < (read_runtime ? 3 : 2)) {
+        std::cerr << "Usage: " << argv[0] << " GridFile" << (read_runtime ? " MaxTime" : "") << " [--workers=N] [--out=sweep-runs] " << RUN_OPTIONS_USAGE << std::endl;
+        return 1;
+    }
+    if (read_runtime) {
+        defaults.runtime = std::stoul(argv[2]);//maxtime
+    }
+    makeDirectory(out_dir);
+    std::vector<Job> jobs = loadJobs(argv[1], out_dir);
+
+    // Checkpoints asked for by signals are written at the start of the next step
+    std::signal(SIGUSR1, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    std::mutex log_mutex;
+    WorkPool pool(n_workers);
+    pool.run(jobs.size(), [&](unsigned ind, unsigned worker) {
+        const Job& job = jobs[ind];
+        // No run is started once the sweep is stopping
+        if (stop_requested) {
+            return;
+        }
+        std::string status = readStatus(job.dir);
+        if (status == "finished" || status == "extinct") {
+            return;
+        }
+        RunConfig config = defaults;
+        config.move = job.move;
+        config.mutation = job.mutation;
+        config.death = job.death;
+        config.seed = job.seed;
+        config.out_dir = job.dir;
+        makeDirectory(job.dir);
+        // A run stopped by an earlier sweep goes on from its last checkpoint
+        std::ifstream checkpoint(job.dir + "/checkpoint.ckp");
+        if (checkpoint) {
+            config.input_file = job.dir + "/checkpoint.ckp";
+        }
+        checkpoint.close();
+
+        Simulation<Model> simulation(config);
+        Simulation<Model>::Status result = simulation.run();
+        status = (result == Simulation<Model>::FINISHED) ? "finished" : (result == Simulation<Model>::EXTINCT) ? "extinct" : "stopped";
+        if (result != Simulation<Model>::STOPPED) {
+            std::ofstream outFile(job.dir + "/status");
+            outFile << status << " " << simulation.get_time() << "\n";
+        }
+        std::lock_guard<std::mutex> lock(log_mutex);
+        std::cout << job.dir << ": " << status << " at time step " << simulation.get_time() << " (worker " << worker << ")" << std::endl
+                  << "  grid memory: " << simulation.memory_report() << std::endl;
+    });
+
+    if (stop_requested) {
+        std::cerr << "Stopped, run the sweep again to go on with the unfinished runs" << std::endl;
+    }
+    return (0);
+}
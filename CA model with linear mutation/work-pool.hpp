@@ -0,0 +1,99 @@
+/*
+  WorkPool runs the jobs 0 to n_job-1 on a fixed number of threads. The
+  jobs are dealt out in turn to the deques of the workers. A worker
+  takes its next job from the front of its own deque and, once it is
+  empty, steals one from the back of the deque of another worker. A
+  job that ends early (an extinct run, for instance) therefore frees
+  its worker at once for the next one, wherever that job was dealt.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  n_worker: number of threads, at least 1.
+
+  ------------------------------------------------------------
+  Methods:
+
+  run(n_job,work):
+
+  Call work(job,worker) once for every job, from the threads of the
+  pool, and return once all of them are done. worker is the index of
+  the calling thread, 0 <= worker < n_worker.
+*/
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef WORKPOOL
+#define WORKPOOL
+
+class WorkPool {
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<unsigned> jobs;
+  };
+
+  const unsigned n_worker;
+  std::vector<Queue> queues;
+
+  inline bool take(const unsigned worker,unsigned& job);
+
+  WorkPool(const WorkPool& rhs);
+  void operator=(const WorkPool& rhs);
+
+public:
+  inline explicit WorkPool(const unsigned a_n_worker);
+
+  template <class Work> inline void run(const unsigned n_job,Work work);
+};
+
+WorkPool::WorkPool(const unsigned a_n_worker)
+  : n_worker(a_n_worker > 0 ? a_n_worker : 1),
+    queues(n_worker)
+{
+}
+
+/* The next job of the worker: its own first one, or else the last one
+   of the first other worker that still has some. Returns false when
+   every deque is empty. */
+bool WorkPool::take(const unsigned worker,unsigned& job)
+{
+  for(unsigned i = 0; i < n_worker; ++i){
+    Queue& queue = queues[(worker + i) % n_worker];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if(queue.jobs.empty())
+      continue;
+    if(i == 0){
+      job = queue.jobs.front();
+      queue.jobs.pop_front();
+    } else {
+      job = queue.jobs.back();
+      queue.jobs.pop_back();
+    }
+    return true;
+  }
+  return false;
+}
+
+template <class Work> void WorkPool::run(const unsigned n_job,Work work)
+{
+  for(unsigned job = 0; job < n_job; ++job)
+    queues[job % n_worker].jobs.push_back(job);
+
+  std::vector<std::thread> threads;
+  for(unsigned worker = 0; worker < n_worker; ++worker){
+    threads.push_back(std::thread([this,worker,&work](){
+      unsigned job;
+      while(take(worker,job))
+        work(job,worker);
+    }));
+  }
+  for(std::thread& thread : threads)
+    thread.join();
+}
+
+#endif
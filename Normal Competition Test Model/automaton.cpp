@@ -1,19 +1,16 @@
 #include "automaton.hpp"
 
-
-unsigned int Automaton::nextId = 0; 
-// Default Constructor
+//Default Constructor 
 Automaton::Automaton()
-    : state(0), id(0), parentId(0) {
+    : state(0), da(0.5), db(0.5), ka(0.5), kb(0.5) {
 }
-
- // copy constructor
+//Copy constructor
 Automaton::Automaton(const Automaton& other)
-    : state(other.state), da(other.da), ka(other.ka),db(other.db), 
-      kb(other.kb), id(other.id),parentId(other.parentId){
-    
+    : state(other.state), da(other.da), db(other.db), ka(other.ka), 
+      kb(other.kb) {
 }
-//assignment operation
+
+//Assignment operation
 Automaton& Automaton::operator=(const Automaton& other) {
     if (this != &other) { 
         state = other.state;
@@ -21,48 +18,28 @@ Automaton& Automaton::operator=(const Automaton& other) {
         ka = other.ka;
         db = other.db;
         kb = other.kb;
-        id = other.id;
-        parentId = other.parentId;
     }
     return *this; 
 }
 
 
 //Calculation of average public goods
-double Automaton::cal_average_k(CA2D<Automaton>* ca, unsigned row, unsigned col) {
+double Automaton::cal_average_k(AutomatonGrid* ca, unsigned row, unsigned col, unsigned radius) {
     double total_k = 0.0;
     unsigned n_alive = 0;
-    int nrow = ca->get_nrow();
-    int ncol = ca->get_ncol();
-
-    int initial_row = row - 2;
-    int initial_col = col - 2;
-    int end_row = row + 2;
-    int end_col = col + 2;
+    int initial_row = row - radius;
+    int initial_col = col - radius;
+    int end_row = row + radius;
+    int end_col = col + radius;
 
     //test output
     //std::cout << "Center cell row: " << row << ", col: " << col << std::endl;
 
     for (int r = initial_row; r <= end_row; ++r) {
         for (int c = initial_col; c <= end_col; ++c) {
-            // periodic boundary
-           int wrapped_r, wrapped_c;
-            
-            if (r <= 0) {
-                wrapped_r = nrow + r;
-            } else if (r > nrow) {
-                wrapped_r = r - nrow;
-            } else {
-                wrapped_r = r;
-            }
-
-            if (c <= 0) {
-                wrapped_c = ncol + c;
-            } else if (c > ncol) {
-                wrapped_c = c - ncol;
-            } else {
-                wrapped_c = c;
-            }
+            // Periodic boundary conditions
+            unsigned wrapped_r = ca->wrap_row(r);
+            unsigned wrapped_c = ca->wrap_col(c);
 
             // Skip Centre Cell
             if (wrapped_r == row && wrapped_c == col) {
@@ -72,24 +49,20 @@ double Automaton::cal_average_k(CA2D<Automaton>* ca, unsigned row, unsigned col)
             //std::cout << "Checking cell at wrapped_r: " << wrapped_r << ", wrapped_c: " << wrapped_c << std::endl;
 
             const auto& neighbor = ca->cell(wrapped_r, wrapped_c);
-            if (neighbor.state == 1) {
-                total_k += neighbor.ka;
+            if (neighbor.get_state() == 1) {
+                total_k += neighbor.get_ka();
                 n_alive += 1;
                 //std::cout << "State: 1, ka: " << self.ka << std::endl;
-            } else if (neighbor.state == 2) {
-                total_k += neighbor.kb;
+            } else if (neighbor.get_state() == 2) {
+                total_k += neighbor.get_kb();
                 n_alive += 1;
                 //std::cout << "State: 2, kb: " << self.kb << std::endl;
-            }
-            else if (neighbor.state == 3) {
-                total_k += neighbor.ka;
+            } else if (neighbor.get_state() == 3) {
+                total_k += neighbor.get_ka();
                 n_alive += 1;
-                //std::cout << "State: 3, kb: " << self.ka << std::endl;
-            }
-            else if (neighbor.state == 4) {
-                total_k += neighbor.kb;
+            } else if (neighbor.get_state() == 4) {
+                total_k += neighbor.get_kb();
                 n_alive += 1;
-                //std::cout << "State: 2, kb: " << self.kb << std::endl;
             }
         }
     }
@@ -97,33 +70,7 @@ double Automaton::cal_average_k(CA2D<Automaton>* ca, unsigned row, unsigned col)
     return n_alive > 0 ? total_k / n_alive : 0.0;
 }
 
-
-
-//exponential mutation
-double Automaton::mutate_trait(double p) {
-    static std::normal_distribution<double> dist(0.0, var); 
-
-    double delta = dist(ran_gen::random); 
-    double p_prime = p * std::exp(-delta); 
-
-    
-    if (p_prime > 1.0) {
-        p_prime = 1.0;
-    } 
-    else if (p_prime < 0.0) {
-        p_prime = 0.0;
-    }
-
-    return p_prime; 
-}
-
-void Automaton::set_mutation(double Newda, double Newka,double Newdb, double Newkb) {
-    da = this->mutate_trait(Newda);
-    ka = this->mutate_trait(Newka);
-    db = this->mutate_trait(Newdb);
-    kb = this->mutate_trait(Newkb);
-}
-
+//Trait values remain the same
 void Automaton::set_keep(double Newda, double Newka,double Newdb, double Newkb) {
     da = Newda;
     ka = Newka;
@@ -131,73 +78,80 @@ void Automaton::set_keep(double Newda, double Newka,double Newdb, double Newkb)
     kb = Newkb;
 }
 
-void Automaton::set_move(double Move) {
-    Move_chance = Move;
-}
-
-void Automaton::set_death(double dea) {
-    death = dea;
-}
-
-void Automaton::set_d(double newda,double newdb) {
-    da = newda;
-    db = newdb;
-}
-
-
-unsigned Automaton::get_id() {
-    return id;
+int Automaton::get_state() const{
+    return state;
 }
 
-unsigned Automaton::get_state() {
-    return state;
+//Public goods produced by the cell, states 1/3 produce ka and states 2/4 produce kb
+double Automaton::get_k() const{
+    if (state == 1 || state == 3) {
+        return ka;
+    } else if (state == 2 || state == 4) {
+        return kb;
+    }
+    return 0.0;
 }
 
 void Automaton::set_state(unsigned newone) {
      state = newone;
 }
 
-double Automaton::get_death () const{
-    return death;
+void Automaton::set_ances(unsigned newone) {
+     ances = newone;
 }
 
-double Automaton::get_move () const{
-    return Move_chance;
+int Automaton::get_ances () const{
+    return ances;
 }
 
-double Automaton::get_da() {
+void Automaton::set_d(double newda,double newdb) {
+    da = newda;
+    db = newdb;
+}
+
+double Automaton::get_da() const{
     return da;
 }
 
-double Automaton::get_ka() {
+double Automaton::get_ka() const{
     return ka;
 }
 
-double Automaton::get_db() {
+double Automaton::get_db() const{
     return db;
 }
 
-double Automaton::get_kb() {
+double Automaton::get_kb() const{
     return kb;
 }
 
-void Automaton::set_id(){
-    id = nextId++ ;
-}
-
-void Automaton::update_id(unsigned int parent){
-    id = nextId++ ;
-    parentId =parent;
-}
-
-//Implemente Friendly Functions
+// Implementing Friendly Functions
 void swap(Automaton& first, Automaton& second) noexcept {
     std::swap(first.state, second.state);
     std::swap(first.da, second.da);
     std::swap(first.ka, second.ka);
     std::swap(first.db, second.db);
     std::swap(first.kb, second.kb);
-    std::swap(first.id, second.id);
-    std::swap(first.parentId, second.parentId);
-    
+}
+
+//Every plane starts with the values of a default constructed Automaton
+AutomatonPlanes::AutomatonPlanes(const unsigned a_nrow,const unsigned a_ncol,const PagePolicy& policy,const unsigned a_halo)
+    : state(a_nrow, a_ncol, policy, a_halo), ances(a_nrow, a_ncol, policy, a_halo), da(a_nrow, a_ncol, policy, a_halo), ka(a_nrow, a_ncol, policy, a_halo),
+      db(a_nrow, a_ncol, policy, a_halo), kb(a_nrow, a_ncol, policy, a_halo) {
+    const Automaton proto;
+    for (std::size_t ind = 0; ind < state.size(); ++ind) {
+        state.cell(ind) = proto.get_state();
+        ances.cell(ind) = 0;
+        da.cell(ind) = proto.get_da();
+        ka.cell(ind) = proto.get_ka();
+        db.cell(ind) = proto.get_db();
+        kb.cell(ind) = proto.get_kb();
+    }
+}
+
+// One line per plane, see CA2D::memory_report()
+std::string AutomatonPlanes::memory_report() const {
+    return "state " + state.memory_report() + "; ances " + ances.memory_report()
+        + "; da " + da.memory_report() + "; ka " + ka.memory_report()
+        + "; db " + db.memory_report() + "; kb " + kb.memory_report();
 }
@@ -1,6 +1,7 @@
 #include "cash-display.hpp"
 
 extern int scale;
+extern int userCol[256][4];
 
 bool CashDisplay::no_other_instantiation = true;
 
@@ -11,7 +12,9 @@ CashDisplay::CashDisplay(const int _window_row,const int _window_col, const std:
     window_is_open(false),
     png_is_open(false),
     margin_color(_margin_color),
-    data(nullptr) // 初始化指针为 nullptr
+    data(nullptr), // 初始化指针为 nullptr
+    png_writer(nullptr),
+    movie_recorder(nullptr)
 {
   /* CashDisplay must have only one instantiation at a time */
   if(no_other_instantiation){
@@ -58,6 +61,7 @@ CashDisplay::CashDisplay(const int _window_row,const int _window_col, const std:
 
     panels.push_back(*iter);
   }
+  painters.resize(panels.size());
 
   /* Set the size of pixel */
   if(_scale>0){
@@ -91,6 +95,10 @@ CashDisplay::~CashDisplay()
 {
   delete[] data;
 
+  /* The frames still in the queue are written before closing */
+  delete png_writer;
+  delete movie_recorder;
+
   if(window_is_open)
     CloseDisplayImmediately();
   if(png_is_open)
@@ -217,6 +225,30 @@ void CashDisplay::put_histogram(const unsigned panel_ind,const std::vector<doubl
     }
 }
 
+void CashDisplay::set_painter(const unsigned panel_ind,const Painter& painter)
+{
+  try{
+    Assert<GeneralError>(!ASSERT::ERROR_CHECK||panel_ind < panels.size());
+  }catch(GeneralError){
+    std::cerr << "CashDisplay::set_painter(): Error, out-of-bound panel_ind=" << panel_ind << std::endl;
+    exit(-1);
+  }
+  painters[panel_ind] = painter;
+}
+
+void CashDisplay::render()
+{
+  for(unsigned panel_ind=0; panel_ind<panels.size(); ++panel_ind){
+    if(!painters[panel_ind])
+      continue;
+    for(int row=1; row<=panels[panel_ind].n_row; ++row){
+      for(int col=1; col<=panels[panel_ind].n_col; ++col){
+	data_at(panel_ind,row,col) = painters[panel_ind](row,col);
+      }
+    }
+  }
+}
+
 bool CashDisplay::xy_window_to_rc_panel(int x,int y,unsigned& panel_ind,int& row,int& col) const
 {
   x = x/scale + 1;
@@ -294,15 +326,45 @@ void CashDisplay::open_window(const std::string& window_title)
   delete[] cstr; // 释放内存
 }
 
-void CashDisplay::open_png(const std::string& directory_name)
+void CashDisplay::open_png(const std::string& directory_name,const unsigned n_threads,const unsigned queue_size,const int level,const std::string& filter)
 {
   char *cstr = new char[directory_name.length() + 1];
   strcpy(cstr, directory_name.c_str());
   OpenPNG(cstr,window_row,window_col);
   png_is_open = true;
+  if(n_threads > 0){
+    png_writer = new PngWriter(n_threads,queue_size,level,filter);
+  }
   delete[] cstr; // 释放内存
 }
 
+void CashDisplay::open_movie(const std::string& file_name,const unsigned key_interval,const int level)
+{
+  if(movie_recorder){
+    std::cerr << "CashDisplay::open_movie(): Error, a movie is already open" << std::endl;
+    exit(-1);
+  }
+  movie_recorder = new MovieRecorder(file_name,window_row,window_col,key_interval,level);
+}
+
+void CashDisplay::draw_movie()
+{
+  if(!movie_recorder){
+    std::cerr << "CashDisplay::draw_movie(): Error, call open_movie() first" << std::endl;
+    exit(-1);
+  }
+  render();
+
+  /* The colors in force, as they would be written to a png file */
+  unsigned char palette[MovieFile::PALETTE_SIZE];
+  for(int color=0; color<256; ++color){
+    palette[3*color] = userCol[color][1];
+    palette[3*color+1] = userCol[color][2];
+    palette[3*color+2] = userCol[color][3];
+  }
+  movie_recorder->add_frame(data,palette);
+}
+
 void CashDisplay::color_rgb(const unsigned char color_ind,const unsigned char r,const unsigned char g,const unsigned char b)
 {
   if(window_is_open || png_is_open){
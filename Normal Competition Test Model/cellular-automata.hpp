@@ -6,20 +6,33 @@
   ------------------------------------------------------------
   Constructer:
 
-  It has two parameters.
-
   nrow: the size of vertical dimension.
   ncol: the size of horizontal dimension.
+  policy: the pages and the NUMA placement of the cells (see
+  page-block.hpp), by default the small pages of the system, placed
+  where they are first touched.
+  halo: the width of the boundaries, 1 by default. It must not be
+  larger than nrow and ncol.
 
   The argument to the template, <T>, is the type of the class
   that will be the type of the automata.
 
   When constructed, it allocates an <T>-array of size
-  (nrow+2)*(ncol+2), where nrow and ncol are the grid
+  (nrow+2*halo)*(ncol+2*halo), where nrow and ncol are the grid
   size. During a simulation, the "inside" of the grid is
   supposed to be manipulated, i.e. the grid of size
   nrow*ncol. The other parts of the grid are considered as the
-  boundaries of the grid.
+  boundaries of the grid: rows and columns 1-halo to 0 and n+1 to
+  n+halo. The array is constructed by the calling thread, which
+  therefore first touches it.
+
+  By default the cells are stored row after row. Compiled with
+  -DCA_TILED, they are stored in square tiles of 8x8 cells (2^CA_TILE_SHIFT
+  on a side, CA_TILE_SHIFT=3 by default), one tile after the other,
+  the cells of a tile row after row. A 5x5 neighborhood then lies in at
+  most 2x2 tiles instead of 5 rows far apart in memory. The array is
+  padded to whole tiles. The layout only shows through index(), so
+  code must not step from one index to another by hand.
 
   ------------------------------------------------------------
   Methods:
@@ -48,6 +61,10 @@
   is used, the automata in the boundaries must be properly
   initilized by the user.
 
+  memory_report():
+
+  A line telling where the array is (see PageBlock::describe()).
+
   xy_neigh_wrap(row,col,nei,nei_row,nei_col),
   xy_neigh_fix(row,col,nei,nei_row,nei_col):
 
@@ -55,32 +72,111 @@
   neighbor. The value of nei_row and nei_col will be set to the wanted
   coordinate.
 
+  wrap_row(row), wrap_col(col):
+
+  The row (column) of the grid that row (col) stands for when the
+  boundaries are wrapped. row must be within nrow of [1,nrow], which
+  is the case of any cell of a window that fits in the torus.
+
+  refresh_halo(), mirror(row,col):
+
+  With wrapped boundaries, the boundaries can hold copies of the cells
+  on the other side of the torus, so that the neighbors of a cell are
+  found at fixed offsets from it, with no wrapping. refresh_halo()
+  copies every cell of the boundaries from the inside, after the grid
+  has been initialized or changed in bulk. mirror(row,col) copies the
+  cell at (row,col) to its images in the boundaries, if it has any: it
+  must be called after every change of a cell when the boundaries are
+  kept up to date. T must be copy-assignable.
+
+  index_near(row,col,nei):
+
+  The index of the nei-th cell of the Moore neighborhood of (row,col),
+  numbered as in neigh_wrap() (0 is the cell itself). The cell is read
+  in the boundaries, with no wrapping: with wrapped boundaries, the
+  boundaries must be up to date. In the row-major layout it is
+  index(row,col) plus an offset taken from a table.
+
+  size():
+
+  The number of cells in the array, boundaries and padding included.
+  cell(ind) is valid for every ind < size().
+
+  prefetch(ind):
+
+  Asks the processor to start loading the cell at ind into the cache,
+  so that an access some time later does not wait for memory. It
+  changes nothing, and costs little when the cell is already cached.
+
+  box_sums(value,row_radius,col_radius,sums):
+
+  Sets sums[(row-1)*ncol+(col-1)], for every cell (row,col), to the sum
+  of value(cell) over the (2*row_radius+1)x(2*col_radius+1) window
+  centred on the cell, centre included, with wrapped boundaries. The
+  window must fit in the torus. value is called once per cell, and the
+  windows are summed by running sums along the rows and then along the
+  columns, so the cost does not depend on the radii. The type S of the
+  sums is the value type of the vector; with an integer type the sums
+  are exact, with a floating point type each one carries the rounding
+  errors of the running sums it comes from.
+
+  periodic_box_sums(grid,value,row_radius,col_radius,sums) does the
+  same on any grid type with the cell(row,col), get_nrow() and
+  get_ncol() of CA2D, such as AutomatonPlanes.
+
 
 */
 
 #include <iostream>
+#include <new>
+#include <vector>
 #include <unistd.h>
+#include "page-block.hpp"
 
 #ifndef CELLULARAUTOMATA
 #define CELLULARAUTOMATA
 
+#ifndef CA_TILE_SHIFT
+#define CA_TILE_SHIFT 3
+#endif
+
+
+template <class G,class F,class S> void periodic_box_sums(const G& grid,const F& value,const unsigned row_radius,const unsigned col_radius,std::vector<S>& sums);
 
 template <class T> class CA2D {
  
 private:
   unsigned nrow;
   unsigned ncol;
-  unsigned ncol2;
+  unsigned halo;
+  unsigned ncol2; // Length of a row of the array, boundaries included
+  std::size_t n_cells; // Size of the array, boundaries and padding included
+
+  // Rows and columns of the Moore neighborhood, in the order of neigh_wrap()
+  static const int NEAR_ROW[9];
+  static const int NEAR_COL[9];
+
+#ifdef CA_TILED
+  static const unsigned TILE_SHIFT = CA_TILE_SHIFT;
+  static const unsigned TILE_MASK = (1u << CA_TILE_SHIFT) - 1;
+  unsigned tile_cols; // Tiles in a row of tiles
+#else
+  int offsets[9]; // Index offsets of the Moore neighborhood
+#endif
   
   /* "cells" is an array of Cells. Each cell contains an
-     automaton. */
+     automaton. The array is built in "block". */
+  PageBlock block;
   T* cells;
+
+  inline static std::size_t array_size(const unsigned a_nrow,const unsigned a_ncol,const unsigned a_halo);
   
 public:
   inline unsigned get_nrow() const;
   inline unsigned get_ncol() const;
-  inline CA2D(const unsigned a_nrow,const unsigned a_ncol);
+  inline CA2D(const unsigned a_nrow,const unsigned a_ncol,const PagePolicy& policy = PagePolicy(),const unsigned a_halo = 1);
   inline ~CA2D();
+  std::string memory_report() const {return block.describe();}
   inline T& cell(const unsigned row,const unsigned col);
   inline const T& cell(const unsigned row,const unsigned col) const;
 
@@ -93,6 +189,19 @@ public:
   inline T& cell(const unsigned ind);
   inline const T& cell(const unsigned ind) const;
   inline unsigned index (const unsigned row,const unsigned col) const;
+  void prefetch(const unsigned ind) const {__builtin_prefetch(cells + ind);}
+
+  /* Periodic windows */
+  inline unsigned wrap_row(const int row) const;
+  inline unsigned wrap_col(const int col) const;
+  template <class F,class S> void box_sums(const F& value,const unsigned row_radius,const unsigned col_radius,std::vector<S>& sums) const;
+
+  /* Wrapped boundaries kept as copies of the inside */
+  unsigned get_halo() const {return halo;}
+  inline void refresh_halo();
+  inline void mirror(const unsigned row,const unsigned col);
+  inline unsigned index_near(const unsigned row,const unsigned col,const unsigned nei) const;
+  std::size_t size() const {return n_cells;}
 
   /* 1st-order neighbor retrieval */
   /* 516
@@ -196,8 +305,144 @@ template <class T> unsigned CA2D<T>::neighbor_converter(const unsigned nei)
 
 template <class T> unsigned CA2D<T>::index(const unsigned row,const unsigned col) const
 {
-  return row*ncol2 + col;
+#ifdef CA_TILED
+  const unsigned r = row + halo - 1;
+  const unsigned c = col + halo - 1;
+  return ((((r >> TILE_SHIFT)*tile_cols + (c >> TILE_SHIFT)) << (2*TILE_SHIFT))
+          | ((r & TILE_MASK) << TILE_SHIFT) | (c & TILE_MASK));
+#else
+  return (row + halo - 1)*ncol2 + (col + halo - 1);
   //return row*512 + col;
+#endif
+}
+
+template <class T> const int CA2D<T>::NEAR_ROW[9] = {0,-1,0,0,1,-1,-1,1,1};
+template <class T> const int CA2D<T>::NEAR_COL[9] = {0,0,-1,1,0,-1,1,-1,1};
+
+// A cell of the boundaries has row (col) from 1-halo, which wraps to the right index
+template <class T> unsigned CA2D<T>::index_near(const unsigned row,const unsigned col,const unsigned nei) const
+{
+#ifdef CA_TILED
+  return index(row + NEAR_ROW[nei],col + NEAR_COL[nei]);
+#else
+  return index(row,col) + offsets[nei];
+#endif
+}
+
+template <class T> unsigned CA2D<T>::wrap_row(const int row) const
+{
+  if(row <= 0) return nrow + row;
+  if(row > static_cast<int>(nrow)) return row - nrow;
+  return row;
+}
+
+template <class T> unsigned CA2D<T>::wrap_col(const int col) const
+{
+  if(col <= 0) return ncol + col;
+  if(col > static_cast<int>(ncol)) return col - ncol;
+  return col;
+}
+
+template <class T> void CA2D<T>::refresh_halo()
+{
+  const int h = halo;
+  const int n_r = nrow;
+  const int n_c = ncol;
+  // Left and right boundaries of the inside rows, then whole boundary rows
+  for(int row = 1; row <= n_r; ++row){
+    for(int col = 1 - h; col <= 0; ++col){
+      cell(index(row,col)) = cell(row,col + n_c);
+      cell(index(row,col + n_c + h)) = cell(row,col + h);
+    }
+  }
+  for(int row = 1 - h; row <= 0; ++row){
+    for(int col = 1 - h; col <= n_c + h; ++col){
+      cell(index(row,col)) = cell(index(row + n_r,col));
+      cell(index(row + n_r + h,col)) = cell(index(row + h,col));
+    }
+  }
+}
+
+template <class T> void CA2D<T>::mirror(const unsigned row,const unsigned col)
+{
+  const bool near_top = row <= halo;
+  const bool near_bottom = row + halo > nrow;
+  const bool near_left = col <= halo;
+  const bool near_right = col + halo > ncol;
+  if(!(near_top || near_bottom || near_left || near_right))
+    return;
+
+  // The images of the cell: shifted by the size of the grid towards the boundaries it is near
+  int rows[3] = {static_cast<int>(row),0,0};
+  int cols[3] = {static_cast<int>(col),0,0};
+  int n_rows = 1, n_cols = 1;
+  if(near_top) rows[n_rows++] = row + nrow;
+  if(near_bottom) rows[n_rows++] = static_cast<int>(row) - static_cast<int>(nrow);
+  if(near_left) cols[n_cols++] = col + ncol;
+  if(near_right) cols[n_cols++] = static_cast<int>(col) - static_cast<int>(ncol);
+  const T& source = cell(row,col);
+  for(int i = 0; i < n_rows; ++i)
+    for(int j = 0; j < n_cols; ++j)
+      if(i > 0 || j > 0)
+        cell(index(rows[i],cols[j])) = source;
+}
+
+template <class T> template <class F,class S> void CA2D<T>::box_sums(const F& value,const unsigned row_radius,const unsigned col_radius,std::vector<S>& sums) const
+{
+  periodic_box_sums(*this,value,row_radius,col_radius,sums);
+}
+
+/* The window of a cell is summed from that of the previous cell by
+   adding the values that enter it and removing those that leave it:
+   first along every row, then along the columns, on whole rows of row
+   sums at a time. */
+template <class G,class F,class S> void periodic_box_sums(const G& grid,const F& value,const unsigned row_radius,const unsigned col_radius,std::vector<S>& sums)
+{
+  const unsigned nrow = grid.get_nrow();
+  const unsigned ncol = grid.get_ncol();
+  if(2*row_radius+1 > nrow || 2*col_radius+1 > ncol){
+    std::cerr << "periodic_box_sums() Error: a window of radius " << row_radius << "x" << col_radius << " does not fit in a " << nrow << "x" << ncol << " grid." << std::endl;
+    exit(-1);
+  }
+
+  // Sums along the rows
+  std::vector<S> row_sums(static_cast<std::size_t>(nrow)*ncol);
+  std::vector<S> line(ncol);
+  for(unsigned row = 1; row <= nrow; ++row){
+    for(unsigned col = 1; col <= ncol; ++col)
+      line[col-1] = value(grid.cell(row,col));
+    S sum = S();
+    for(unsigned c = ncol - col_radius; c < ncol; ++c)
+      sum += line[c];
+    for(unsigned c = 0; c <= col_radius; ++c)
+      sum += line[c];
+    S* out = &row_sums[static_cast<std::size_t>(row-1)*ncol];
+    for(unsigned c = 0; c < ncol; ++c){
+      out[c] = sum;
+      sum += line[(c + col_radius + 1) % ncol];
+      sum -= line[(c + ncol - col_radius) % ncol];
+    }
+  }
+
+  // Sums of the row sums along the columns
+  sums.assign(static_cast<std::size_t>(nrow)*ncol,S());
+  std::vector<S> sum(ncol,S());
+  for(unsigned r = nrow - row_radius; r < nrow; ++r)
+    for(unsigned c = 0; c < ncol; ++c)
+      sum[c] += row_sums[static_cast<std::size_t>(r)*ncol + c];
+  for(unsigned r = 0; r <= row_radius; ++r)
+    for(unsigned c = 0; c < ncol; ++c)
+      sum[c] += row_sums[static_cast<std::size_t>(r)*ncol + c];
+  for(unsigned r = 0; r < nrow; ++r){
+    const S* enter = &row_sums[static_cast<std::size_t>((r + row_radius + 1) % nrow)*ncol];
+    const S* leave = &row_sums[static_cast<std::size_t>((r + nrow - row_radius) % nrow)*ncol];
+    S* out = &sums[static_cast<std::size_t>(r)*ncol];
+    for(unsigned c = 0; c < ncol; ++c){
+      out[c] = sum[c];
+      sum[c] += enter[c];
+      sum[c] -= leave[c];
+    }
+  }
 }
 
 template <class T> T& CA2D<T>::cell(const unsigned row,const unsigned col)
@@ -388,27 +633,53 @@ template <class T> void CA2D<T>::xy_neigh_wrap(const unsigned row,const unsigned
     }
 }
 
-template <class T> CA2D<T>::CA2D(const unsigned a_nrow,const  unsigned a_ncol)
+template <class T> CA2D<T>::CA2D(const unsigned a_nrow,const  unsigned a_ncol,const PagePolicy& policy,const unsigned a_halo)
   : nrow(a_nrow), 
     ncol(a_ncol),
-    ncol2(a_ncol+2)
+    halo(a_halo),
+    ncol2(a_ncol+2*a_halo),
+    n_cells(array_size(a_nrow,a_ncol,a_halo)),
+#ifdef CA_TILED
+    tile_cols((a_ncol+2*a_halo+TILE_MASK) >> TILE_SHIFT),
+#endif
+    block(sizeof(T)*n_cells,policy),
+    cells(nullptr)
 {
   if(nrow==0 || ncol==0){
     std::cerr << "CA2D() Error: nrow=ncol=0 is not allowed." << std::endl;
     return;
   }
-
-  try{
-    cells = new T [(nrow+2)*(ncol+2)];
-  }catch(std::bad_alloc){
-    std::cerr << "CA2D::CA2D() Memory exausted" << std::endl;
+  if(halo > nrow || halo > ncol){
+    std::cerr << "CA2D() Error: the boundaries cannot be wider than the grid." << std::endl;
     exit(-1);
   }
+
+#ifndef CA_TILED
+  for(unsigned nei = 0; nei < 9; ++nei)
+    offsets[nei] = NEAR_ROW[nei]*static_cast<int>(ncol2) + NEAR_COL[nei];
+#endif
+
+  cells = static_cast<T*>(block.data());
+  for(std::size_t ind = 0; ind < n_cells; ++ind)
+    new (cells + ind) T;
+}
+
+// Cells in the array: the grid and its boundaries, padded to whole tiles in the tiled layout
+template <class T> std::size_t CA2D<T>::array_size(const unsigned a_nrow,const unsigned a_ncol,const unsigned a_halo)
+{
+#ifdef CA_TILED
+  const std::size_t side = std::size_t(1) << CA_TILE_SHIFT;
+  return (a_nrow+2*a_halo+side-1)/side*side * ((a_ncol+2*a_halo+side-1)/side*side);
+#else
+  return (a_nrow+2*a_halo)*static_cast<std::size_t>(a_ncol+2*a_halo);
+#endif
 }
 
 template <class T>  CA2D<T>::~CA2D()
 {
-  delete[] cells;
+  if(cells)
+    for(std::size_t ind = 0; ind < n_cells; ++ind)
+      cells[ind].~T();
 }
 
 template <class T> unsigned CA2D<T>::index_neigh_fix2(const unsigned row,const unsigned col,const unsigned nei,const unsigned neinei) const
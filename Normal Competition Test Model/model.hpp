@@ -0,0 +1,21 @@
+/*
+  The variant of the model built in this folder: its policies (see
+  model-policies.hpp), the name written in its checkpoints and the
+  number of steps between two frames of its movie.
+*/
+
+#include "model-policies.hpp"
+
+#ifndef MODEL
+#define MODEL
+
+struct Model {
+  typedef ExponentialMutation Mutation;
+  typedef NoKill Perturbation;
+  typedef Local Neighborhood;
+  typedef TwoSystems Systems;
+  static const char* name() {return "competition-normal";}
+  static const unsigned MOVIE_INTERVAL = 10000;
+};
+
+#endif
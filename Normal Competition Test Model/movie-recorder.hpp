@@ -0,0 +1,533 @@
+/*
+  MovieRecorder writes the frames of a movie into a single file, as an
+  alternative to one png file per frame. MovieReader reads them back,
+  and movie-export converts such a file into png files or a y4m video.
+
+  A frame is the array of color indices drawn by CashDisplay. Like
+  BlockMovie() of movie.c, it is stored as runs of pixels of one color
+  (pixel by pixel where the colors vary), but only the pixels that
+  differ from the previous frame are stored: a frame in which few cells
+  have changed takes a few bytes. Every key_interval frames, a key
+  frame is stored against a black frame instead, so that a reader can
+  start from it without decoding the frames before. When the colors
+  are changed, the new palette is stored with the frame. The frames
+  are then compressed with zlib, unless that does not make them
+  smaller.
+
+  When the file is closed, an index of the frames is appended to it, so
+  that a reader seeks a frame directly. A file whose writing was
+  interrupted has no index, but all its complete frames can still be
+  read: the reader then finds them by reading the file from the start.
+
+  ------------------------------------------------------------
+  File format:
+
+  The numbers are in the byte order of the machine that wrote the file.
+
+  header: "CASHMOV\n", version (uint32), nrow, ncol, key_interval
+  (uint32).
+
+  frame: flags (uint8, KEY_FRAME | NEW_PALETTE | COMPRESSED), size of
+  the rest of the frame after the palette (uint32), the palette if
+  NEW_PALETTE (256 x r,g,b), then the payload, or if COMPRESSED its
+  size (uint32) and the payload compressed by zlib. The payload is a
+  list of (skip, code, colors) meaning that, after skip unchanged
+  pixels, the next n pixels have the color that follows if code is 2n,
+  or the n colors that follow if code is 2n+1. Skip and code are
+  variable-length integers (7 bits per byte, the high bit meaning that
+  more bytes follow), pixels are in row-major order and those after
+  the last run are unchanged.
+
+  index: INDEX (uint8), the number of frames (uint32), then for each
+  frame its position in the file (uint64) and its flags (uint8).
+
+  trailer: the position of the index (uint64), "CASHIDX\n".
+
+  ------------------------------------------------------------
+  MovieRecorder
+
+  Constructer:
+
+  file_name: the file to write, replaced if it exists.
+
+  nrow, ncol: the size of the frames.
+
+  key_interval: the number of frames between two key frames, at least
+  1. A reader seeking a frame decodes at most key_interval frames.
+
+  level: the zlib compression level, from 1 (fastest) to 9 (smallest),
+  or 0 not to compress the frames.
+
+  Methods:
+
+  add_frame(data,palette):
+
+  Appends the frame data (nrow x ncol color indices) drawn with the
+  colors palette (256 x r,g,b).
+
+  close():
+
+  Writes the index and closes the file. The destructor closes the file
+  if it is still open.
+
+  ------------------------------------------------------------
+  MovieReader
+
+  Constructer:
+
+  file_name: the file to read.
+
+  Methods:
+
+  get_n_row(), get_n_col(), get_n_frames(): the size of the frames and
+  their number.
+
+  frame(n): the n-th frame (from 0), nrow x ncol color indices.
+
+  palette(): the colors of the frame last returned (256 x r,g,b).
+
+  Reading the frames in order decodes each of them once. Any other
+  order starts from the closest key frame before.
+
+  An error, of writing or in the content of a file, prints a message
+  and terminates the program.
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#ifndef MOVIE_RECORDER
+#define MOVIE_RECORDER
+
+namespace MovieFile {
+  const char MAGIC[8] = {'C','A','S','H','M','O','V','\n'};
+  const char INDEX_MAGIC[8] = {'C','A','S','H','I','D','X','\n'};
+  const std::uint32_t VERSION = 1;
+
+  const std::uint8_t KEY_FRAME = 1;
+  const std::uint8_t NEW_PALETTE = 2;
+  const std::uint8_t COMPRESSED = 4;
+  const std::uint8_t INDEX = 128;
+
+  const unsigned PALETTE_SIZE = 3*256;
+
+  // Size of the header, then of a frame before its palette
+  const unsigned HEADER_SIZE = 8 + 4*4;
+  const unsigned FRAME_HEADER_SIZE = 1 + 4;
+}
+
+class MovieRecorder {
+
+private:
+  std::string file_name;
+  std::ofstream file;
+  std::uint32_t nrow;
+  std::uint32_t ncol;
+  std::uint32_t key_interval;
+  int level;
+
+  // The last frame and palette written
+  std::vector<unsigned char> previous;
+  std::vector<unsigned char> previous_palette;
+
+  std::vector<unsigned char> payload;
+  std::vector<unsigned char> packed;
+  std::vector<std::uint64_t> positions;
+  std::vector<std::uint8_t> frame_flags;
+
+  template <class T> void put(const T& value) {file.write(reinterpret_cast<const char*>(&value),sizeof(T));}
+  // Shorter runs are stored pixel by pixel
+  static const std::size_t MIN_RUN = 3;
+
+  inline std::size_t run_end(const unsigned char* data,const std::size_t i) const;
+  inline void put_varint(std::uint64_t value);
+  inline void check() const;
+
+  MovieRecorder(const MovieRecorder& rhs);
+  void operator=(const MovieRecorder& rhs);
+
+public:
+  inline MovieRecorder(const std::string& a_file_name,const unsigned a_nrow,const unsigned a_ncol,const unsigned a_key_interval=100,const int a_level=1);
+  inline ~MovieRecorder();
+
+  inline void add_frame(const unsigned char* data,const unsigned char* palette);
+  inline void close();
+};
+
+MovieRecorder::MovieRecorder(const std::string& a_file_name,const unsigned a_nrow,const unsigned a_ncol,const unsigned a_key_interval,const int a_level)
+  : file_name(a_file_name),
+    file(a_file_name.c_str(),std::ios::binary | std::ios::trunc),
+    nrow(a_nrow),
+    ncol(a_ncol),
+    key_interval(a_key_interval),
+    level(a_level),
+    previous(a_nrow*a_ncol,0)
+{
+  if(nrow==0 || ncol==0 || key_interval==0){
+    std::cerr << "MovieRecorder() Error: nrow=" << nrow << " ncol=" << ncol << " key_interval=" << key_interval << ", all must be positive." << std::endl;
+    exit(-1);
+  }
+  if(level < 0 || level > 9){
+    std::cerr << "MovieRecorder() Error: the compression level " << level << " is not between 0 and 9." << std::endl;
+    exit(-1);
+  }
+  if(!file){
+    std::cerr << "MovieRecorder() Error: cannot open " << file_name << std::endl;
+    exit(-1);
+  }
+  file.write(MovieFile::MAGIC,sizeof(MovieFile::MAGIC));
+  put(MovieFile::VERSION);
+  put(nrow);
+  put(ncol);
+  put(key_interval);
+  check();
+}
+
+MovieRecorder::~MovieRecorder()
+{
+  if(file.is_open())
+    close();
+}
+
+void MovieRecorder::put_varint(std::uint64_t value)
+{
+  while(value >= 128){
+    payload.push_back(static_cast<unsigned char>(value | 128));
+    value >>= 7;
+  }
+  payload.push_back(static_cast<unsigned char>(value));
+}
+
+// The end of the run of pixels of the color of pixel i
+std::size_t MovieRecorder::run_end(const unsigned char* data,const std::size_t i) const
+{
+  std::size_t end = i + 1;
+  while(end < previous.size() && data[end] == data[i])
+    ++end;
+  return end;
+}
+
+void MovieRecorder::check() const
+{
+  if(!file){
+    std::cerr << "MovieRecorder Error: cannot write " << file_name << std::endl;
+    exit(-1);
+  }
+}
+
+void MovieRecorder::add_frame(const unsigned char* data,const unsigned char* palette)
+{
+  std::uint8_t flags = 0;
+  if(positions.size() % key_interval == 0){
+    flags |= MovieFile::KEY_FRAME;
+    std::fill(previous.begin(),previous.end(),0);
+  }
+  if(previous_palette.empty() || !std::equal(previous_palette.begin(),previous_palette.end(),palette)){
+    flags |= MovieFile::NEW_PALETTE;
+    previous_palette.assign(palette,palette + MovieFile::PALETTE_SIZE);
+  }
+
+  payload.clear();
+  const std::size_t size = previous.size();
+  std::size_t last = 0; // The first pixel after the last run
+  std::size_t i = 0;
+  while(i < size){
+    if(data[i] == previous[i]){
+      ++i;
+      continue;
+    }
+    put_varint(i - last);
+    std::size_t end = run_end(data,i);
+    if(end - i >= MIN_RUN){
+      // A run of pixels of one color
+      put_varint(2*(end - i));
+      payload.push_back(data[i]);
+    }else{
+      /* Pixels of different colors, up to a run or to unchanged
+         pixels */
+      end = i;
+      while(end < size && run_end(data,end) - end < MIN_RUN && !(data[end] == previous[end] && (end + 1 == size || data[end+1] == previous[end+1])))
+        ++end;
+      put_varint(2*(end - i) + 1);
+      payload.insert(payload.end(),data + i,data + end);
+    }
+    i = last = end;
+  }
+  std::memcpy(previous.data(),data,size);
+
+  // The payload is compressed unless that does not make it smaller
+  if(level > 0){
+    uLongf packed_size = compressBound(payload.size());
+    packed.resize(packed_size);
+    if(compress2(packed.data(),&packed_size,payload.data(),payload.size(),level) == Z_OK && packed_size + 4 < payload.size()){
+      flags |= MovieFile::COMPRESSED;
+      packed.resize(packed_size);
+    }
+  }
+
+  positions.push_back(static_cast<std::uint64_t>(file.tellp()));
+  frame_flags.push_back(flags);
+  put(flags);
+  if(flags & MovieFile::COMPRESSED){
+    put(static_cast<std::uint32_t>(4 + packed.size()));
+  }else{
+    put(static_cast<std::uint32_t>(payload.size()));
+  }
+  if(flags & MovieFile::NEW_PALETTE)
+    file.write(reinterpret_cast<const char*>(palette),MovieFile::PALETTE_SIZE);
+  if(flags & MovieFile::COMPRESSED){
+    put(static_cast<std::uint32_t>(payload.size()));
+    file.write(reinterpret_cast<const char*>(packed.data()),packed.size());
+  }else{
+    file.write(reinterpret_cast<const char*>(payload.data()),payload.size());
+  }
+  check();
+}
+
+void MovieRecorder::close()
+{
+  const std::uint64_t index_position = static_cast<std::uint64_t>(file.tellp());
+  put(MovieFile::INDEX);
+  put(static_cast<std::uint32_t>(positions.size()));
+  for(std::size_t n = 0; n < positions.size(); ++n){
+    put(positions[n]);
+    put(frame_flags[n]);
+  }
+  put(index_position);
+  file.write(MovieFile::INDEX_MAGIC,sizeof(MovieFile::INDEX_MAGIC));
+  check();
+  file.close();
+}
+
+
+class MovieReader {
+
+private:
+  std::string file_name;
+  std::ifstream file;
+  std::uint32_t nrow;
+  std::uint32_t ncol;
+
+  std::vector<std::uint64_t> positions;
+  std::vector<std::uint8_t> frame_flags;
+
+  // The frame last decoded, -1 if none
+  long current;
+  std::vector<unsigned char> image;
+  std::vector<unsigned char> colors;
+  std::vector<unsigned char> payload;
+  std::vector<unsigned char> packed;
+
+  template <class T> bool get(T& value) {return static_cast<bool>(file.read(reinterpret_cast<char*>(&value),sizeof(T)));}
+  inline bool read_index();
+  inline void scan_frames();
+  inline void decode(const long n);
+  inline void error(const std::string& message) const;
+
+  MovieReader(const MovieReader& rhs);
+  void operator=(const MovieReader& rhs);
+
+public:
+  inline explicit MovieReader(const std::string& a_file_name);
+
+  unsigned get_n_row() const {return nrow;}
+  unsigned get_n_col() const {return ncol;}
+  unsigned long get_n_frames() const {return positions.size();}
+
+  inline const unsigned char* frame(const unsigned long n);
+  const unsigned char* palette() const {return colors.data();}
+};
+
+MovieReader::MovieReader(const std::string& a_file_name)
+  : file_name(a_file_name),
+    file(a_file_name.c_str(),std::ios::binary),
+    current(-1),
+    colors(MovieFile::PALETTE_SIZE,0)
+{
+  if(!file)
+    error("cannot open the file");
+  char magic[sizeof(MovieFile::MAGIC)];
+  std::uint32_t version, key_interval;
+  if(!file.read(magic,sizeof(magic)) || std::memcmp(magic,MovieFile::MAGIC,sizeof(magic)) != 0)
+    error("not a movie file");
+  if(!get(version) || version != MovieFile::VERSION)
+    error("unknown version");
+  if(!get(nrow) || !get(ncol) || !get(key_interval) || nrow == 0 || ncol == 0)
+    error("bad header");
+  image.assign(static_cast<std::size_t>(nrow)*ncol,0);
+
+  if(!read_index())
+    scan_frames();
+}
+
+void MovieReader::error(const std::string& message) const
+{
+  std::cerr << "MovieReader Error: " << file_name << ": " << message << std::endl;
+  exit(-1);
+}
+
+// Reads the index at the end of the file, false if there is none
+bool MovieReader::read_index()
+{
+  char magic[sizeof(MovieFile::INDEX_MAGIC)];
+  std::uint64_t index_position;
+  file.clear();
+  if(!file.seekg(-static_cast<std::streamoff>(sizeof(index_position) + sizeof(magic)),std::ios::end))
+    return false;
+  const std::streamoff trailer_position = file.tellg();
+  if(!get(index_position) || !file.read(magic,sizeof(magic)) || std::memcmp(magic,MovieFile::INDEX_MAGIC,sizeof(magic)) != 0)
+    return false;
+  if(index_position < MovieFile::HEADER_SIZE || index_position >= static_cast<std::uint64_t>(trailer_position))
+    return false;
+
+  std::uint8_t tag;
+  std::uint32_t n_frames;
+  file.seekg(index_position);
+  if(!get(tag) || tag != MovieFile::INDEX || !get(n_frames))
+    return false;
+  positions.resize(n_frames);
+  frame_flags.resize(n_frames);
+  for(std::uint32_t n = 0; n < n_frames; ++n){
+    if(!get(positions[n]) || !get(frame_flags[n]))
+      return false;
+  }
+  return true;
+}
+
+// Finds the complete frames of a file that has no index
+void MovieReader::scan_frames()
+{
+  positions.clear();
+  frame_flags.clear();
+  file.clear();
+  std::uint64_t position = MovieFile::HEADER_SIZE;
+  file.seekg(0,std::ios::end);
+  const std::uint64_t end = static_cast<std::uint64_t>(file.tellg());
+  for(;;){
+    std::uint8_t flags;
+    std::uint32_t size;
+    file.seekg(position);
+    if(!get(flags) || (flags & MovieFile::INDEX) || !get(size))
+      break;
+    std::uint64_t next = position + MovieFile::FRAME_HEADER_SIZE + size;
+    if(flags & MovieFile::NEW_PALETTE)
+      next += MovieFile::PALETTE_SIZE;
+    if(next > end)
+      break;
+    positions.push_back(position);
+    frame_flags.push_back(flags);
+    position = next;
+  }
+  if(positions.empty() || !(frame_flags[0] & MovieFile::KEY_FRAME))
+    error("no complete frame");
+  std::cerr << "MovieReader: " << file_name << " has no index, " << positions.size() << " complete frames found" << std::endl;
+}
+
+// Applies the frame n to the image
+void MovieReader::decode(const long n)
+{
+  std::uint8_t flags;
+  std::uint32_t size;
+  file.clear();
+  file.seekg(positions[n]);
+  if(!get(flags) || !get(size))
+    error("truncated frame");
+  if(flags & MovieFile::NEW_PALETTE){
+    if(!file.read(reinterpret_cast<char*>(colors.data()),MovieFile::PALETTE_SIZE))
+      error("truncated palette");
+  }
+  if(flags & MovieFile::COMPRESSED){
+    std::uint32_t payload_size;
+    if(size < 4 || !get(payload_size))
+      error("truncated frame");
+    packed.resize(size - 4);
+    payload.resize(payload_size);
+    if(!file.read(reinterpret_cast<char*>(packed.data()),packed.size()))
+      error("truncated frame");
+    uLongf unpacked_size = payload_size;
+    if(uncompress(payload.data(),&unpacked_size,packed.data(),packed.size()) != Z_OK || unpacked_size != payload_size)
+      error("bad compressed frame");
+  }else{
+    payload.resize(size);
+    if(!file.read(reinterpret_cast<char*>(payload.data()),size))
+      error("truncated frame");
+  }
+
+  if(flags & MovieFile::KEY_FRAME)
+    std::fill(image.begin(),image.end(),0);
+  std::size_t i = 0;
+  std::size_t p = 0;
+  while(p < payload.size()){
+    std::uint64_t run[2] = {0,0};
+    for(unsigned k = 0; k < 2; ++k){
+      for(unsigned shift = 0; ; shift += 7){
+        if(p >= payload.size() || shift > 63)
+          error("bad run");
+        const unsigned char byte = payload[p++];
+        run[k] |= static_cast<std::uint64_t>(byte & 127) << shift;
+        if(!(byte & 128))
+          break;
+      }
+    }
+    const std::uint64_t length = run[1] / 2;
+    const bool literal = run[1] % 2;
+    if(run[0] + length > image.size() - i || p + (literal ? length : 1) > payload.size())
+      error("bad run");
+    i += run[0];
+    if(literal){
+      std::memcpy(image.data() + i,payload.data() + p,length);
+      p += length;
+    }else{
+      std::memset(image.data() + i,payload[p++],length);
+    }
+    i += length;
+  }
+  current = n;
+}
+
+const unsigned char* MovieReader::frame(const unsigned long n)
+{
+  if(n >= positions.size()){
+    std::cerr << "MovieReader::frame() Error: frame " << n << " of " << positions.size() << std::endl;
+    exit(-1);
+  }
+  const long target = static_cast<long>(n);
+  long start = target;
+  while(!(frame_flags[start] & MovieFile::KEY_FRAME)){
+    if(start == 0)
+      error("the first frame is not a key frame");
+    --start;
+  }
+  // Going on from the frame last decoded is cheaper than from the key frame
+  if(current >= start && current <= target)
+    start = current + 1;
+
+  /* A palette is only stored when it changes: after a seek, the palette
+     in force is the last one stored before the frame. */
+  if(start != current + 1){
+    for(long m = start; m >= 0; --m){
+      if(frame_flags[m] & MovieFile::NEW_PALETTE){
+        if(m < start){
+          file.clear();
+          file.seekg(positions[m] + MovieFile::FRAME_HEADER_SIZE);
+          if(!file.read(reinterpret_cast<char*>(colors.data()),MovieFile::PALETTE_SIZE))
+            error("truncated palette");
+        }
+        break;
+      }
+    }
+  }
+
+  for(long m = start; m <= target; ++m)
+    decode(m);
+  return image.data();
+}
+
+#endif
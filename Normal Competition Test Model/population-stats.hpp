@@ -0,0 +1,231 @@
+/*
+  PopulationStats keeps, for groups of live cells, the number of cells
+  and the sums of their traits, so that the averages written to the
+  output files are read in constant time instead of scanning the grid.
+
+  Cells of odd states (1 and 3) are of type a and carry ka and da, cells
+  of even states (2 and 4) are of type b and carry kb and db. The traits
+  summed for a cell are those of its own type, k and d below.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  nrow, ncol: the size of the grid it follows.
+
+  The first argument to the template, <G>, is the grid type, either
+  CA2D<Automaton> or AutomatonPlanes. The second one, <Key>, gives the
+  group of a cell: Key::of(cell) must be a number smaller than N_GROUP,
+  0 meaning that the cell is not counted. ByState groups the live cells
+  by their state and ByAncestor by their ancestor tag.
+
+  ------------------------------------------------------------
+  Methods:
+
+  rebuild(ca):
+
+  Recomputes all the sums from scratch, adding the cells in the order
+  of a row-by-row scan of the grid. Call it after the grid has been
+  initialized or loaded, after any bulk change that is not reported
+  cell by cell, and from time to time (see Precision).
+
+  refresh(ca,row,col):
+
+  Must be called after the cell at (row,col) has been born, has died,
+  has been swapped or has changed its traits or its group. It removes
+  the values registered for the cell and adds the current ones. Calling
+  it on an unchanged cell costs nothing.
+
+  count(g), sum_k(g), sum_d(g): the number of cells of group g and the
+  sums of their traits.
+
+  mean_k(g), mean_d(g): the average traits of group g, or 0 when the
+  group is empty.
+
+  mean_k(g_first,g_last): the average k of the cells of groups g_first
+  to g_last together, or 0 when they are all empty.
+
+  get_totals(totals), set_totals(totals):
+
+  Copy the sums of d out of and back into the object, one per group. A
+  run resumed from a checkpoint calls rebuild() and then set_totals(),
+  so that it goes on with the rounding errors of the run that wrote the
+  checkpoint. The sums of k need no copy, rebuild() gives them exactly.
+
+  ------------------------------------------------------------
+  Precision:
+
+  The counts are exact. The sums of k are kept in 64-bit fixed point,
+  like those of PublicGoodsField, so they never drift: a k is at most 1,
+  and the number of fractional bits is the largest one, up to
+  MAX_FRACTION_BITS, with which the k of the whole grid cannot overflow
+  (52 up to 2047 cells, 49 for a 100x100 grid). Each k is rounded to the
+  nearest multiple of 2^-fraction_bits when registered; the sums of
+  these values are exact, and only the means taken from them round.
+
+  The sums of d are floating point. Every event adds and removes values
+  from them, so their rounding errors accumulate, slowly, with the
+  number of events. A rebuild() gives the same sums as a scan of the
+  grid and cancels this drift.
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#ifndef POPULATION_STATS
+#define POPULATION_STATS
+
+// Groups the live cells by state
+struct ByState {
+  template <class C> static unsigned of(const C& cell) {return cell.get_state();}
+};
+
+// Groups the live cells by ancestor tag
+struct ByAncestor {
+  template <class C> static unsigned of(const C& cell) {return (cell.get_state() != 0) ? cell.get_ances() : 0;}
+};
+
+template <class G,class Key> class PopulationStats {
+
+public:
+  static const unsigned N_GROUP = 5;
+
+private:
+  static const int MAX_FRACTION_BITS = 52;
+
+  unsigned nrow;
+  unsigned ncol;
+  int fraction_bits; // Of the sums of k (see Precision)
+
+  unsigned n_cell[N_GROUP];
+  std::int64_t k_total[N_GROUP];
+  double d_total[N_GROUP];
+
+  // The group and the traits currently registered for each cell, k in fixed point
+  std::vector<unsigned char> group_own;
+  std::vector<std::int64_t> k_own;
+  std::vector<double> d_own;
+
+  inline unsigned offset(const unsigned row,const unsigned col) const;
+  double to_k(const std::int64_t k) const {return std::ldexp(static_cast<double>(k),-fraction_bits);}
+
+public:
+  inline PopulationStats(const unsigned a_nrow,const unsigned a_ncol);
+
+  inline void rebuild(const G& ca);
+  inline void refresh(const G& ca,const unsigned row,const unsigned col);
+
+  unsigned count(const unsigned g) const {return n_cell[g];}
+  double sum_k(const unsigned g) const {return to_k(k_total[g]);}
+  double sum_d(const unsigned g) const {return d_total[g];}
+  double mean_k(const unsigned g) const {return mean_k(g,g);}
+  double mean_d(const unsigned g) const {return (n_cell[g] > 0) ? d_total[g] / n_cell[g] : 0.0;}
+  inline double mean_k(const unsigned g_first,const unsigned g_last) const;
+
+  inline void get_totals(std::vector<double>& totals) const;
+  inline void set_totals(const std::vector<double>& totals);
+};
+
+template <class G,class Key> const unsigned PopulationStats<G,Key>::N_GROUP;
+template <class G,class Key> const int PopulationStats<G,Key>::MAX_FRACTION_BITS;
+
+template <class G,class Key> PopulationStats<G,Key>::PopulationStats(const unsigned a_nrow,const unsigned a_ncol)
+  : nrow(a_nrow),
+    ncol(a_ncol),
+    fraction_bits(MAX_FRACTION_BITS),
+    group_own(a_nrow*a_ncol,0),
+    k_own(a_nrow*a_ncol,0),
+    d_own(a_nrow*a_ncol,0.0)
+{
+  if(nrow==0 || ncol==0){
+    std::cerr << "PopulationStats() Error: nrow=ncol=0 is not allowed." << std::endl;
+  }
+  // The sum of the k of the whole grid must stay below 2^63
+  const std::uint64_t n_grid = static_cast<std::uint64_t>(nrow) * ncol;
+  while(fraction_bits > 0 && n_grid >= (std::uint64_t(1) << (63 - fraction_bits)))
+    --fraction_bits;
+  std::fill(n_cell,n_cell+N_GROUP,0);
+  std::fill(k_total,k_total+N_GROUP,0);
+  std::fill(d_total,d_total+N_GROUP,0.0);
+}
+
+template <class G,class Key> unsigned PopulationStats<G,Key>::offset(const unsigned row,const unsigned col) const
+{
+  return (row-1)*ncol + (col-1);
+}
+
+template <class G,class Key> void PopulationStats<G,Key>::rebuild(const G& ca)
+{
+  std::fill(n_cell,n_cell+N_GROUP,0);
+  std::fill(k_total,k_total+N_GROUP,0);
+  std::fill(d_total,d_total+N_GROUP,0.0);
+  std::fill(group_own.begin(),group_own.end(),0);
+  for(unsigned row = 1; row <= nrow; ++row){
+    for(unsigned col = 1; col <= ncol; ++col){
+      refresh(ca,row,col);
+    }
+  }
+}
+
+template <class G,class Key> void PopulationStats<G,Key>::refresh(const G& ca,const unsigned row,const unsigned col)
+{
+  const unsigned ind = offset(row,col);
+  const auto& cell = ca.cell(row,col);
+  const unsigned g_new = Key::of(cell);
+  std::int64_t k_new = 0;
+  double d_new = 0.0;
+  if(g_new != 0){
+    const bool type_a = (cell.get_state() % 2 == 1);
+    k_new = std::llround(std::ldexp(type_a ? cell.get_ka() : cell.get_kb(),fraction_bits));
+    d_new = type_a ? cell.get_da() : cell.get_db();
+  }
+  const unsigned g_old = group_own[ind];
+  if(g_new == g_old && (g_new == 0 || (k_new == k_own[ind] && d_new == d_own[ind])))
+    return;
+
+  if(g_old != 0){
+    --n_cell[g_old];
+    k_total[g_old] -= k_own[ind];
+    d_total[g_old] -= d_own[ind];
+  }
+  group_own[ind] = g_new;
+  k_own[ind] = k_new;
+  d_own[ind] = d_new;
+  if(g_new != 0){
+    ++n_cell[g_new];
+    k_total[g_new] += k_new;
+    d_total[g_new] += d_new;
+  }
+}
+
+/* The fixed point sums are added before the single rounding of the
+   division */
+template <class G,class Key> double PopulationStats<G,Key>::mean_k(const unsigned g_first,const unsigned g_last) const
+{
+  unsigned n = 0;
+  std::int64_t k = 0;
+  for(unsigned g = g_first; g <= g_last; ++g){
+    n += n_cell[g];
+    k += k_total[g];
+  }
+  return (n > 0) ? std::ldexp(static_cast<double>(k) / n,-fraction_bits) : 0.0;
+}
+
+template <class G,class Key> void PopulationStats<G,Key>::get_totals(std::vector<double>& totals) const
+{
+  totals.assign(d_total,d_total+N_GROUP);
+}
+
+template <class G,class Key> void PopulationStats<G,Key>::set_totals(const std::vector<double>& totals)
+{
+  if(totals.size() != N_GROUP){
+    std::cerr << "PopulationStats::set_totals() Error: " << totals.size() << " sums given, " << N_GROUP << " expected." << std::endl;
+    exit(-1);
+  }
+  std::copy(totals.begin(),totals.end(),d_total);
+}
+
+#endif
@@ -1,91 +1,72 @@
 #include <math.h>
 #include <stdio.h>
+#include <stdint.h>
 
-#define MBIG 1000000000
-#define MSEED 161803398
-#define MZ 0
-#define FAC (1.0/MBIG)
+/* uniform() and ran2() draw from two streams of a Philox4x32-10
+   counter-based generator (Salmon et al. 2011), the same generator as
+   CounterRng in counter-rng.hpp. The n-th number of a stream only
+   depends on the seed, the stream and n. */
 
-int idum = -1;
-long idum2 = -1;
+typedef struct {
+  uint64_t position; /* Index of the next number in the stream */
+  uint64_t cached; /* The last block computed, holding the numbers 2*cached and 2*cached+1 */
+  uint64_t block[2];
+} PhiloxStream;
 
-double uniform /*ran3*/()
-/* Knuth's substrative method, see Numerical Recipes */
+static uint64_t philox_key = 0;
+static PhiloxStream stream_uniform = {0, ~(uint64_t)0, {0, 0}};
+static PhiloxStream stream_ran2 = {0, ~(uint64_t)0, {0, 0}};
+
+static void philox(uint64_t stream, uint64_t n, uint64_t out[2])
 {
-  static int inext,inextp;
-  static long ma[56];
-  static int iff=0;
-  long mj,mk;
-  int i,ii,k;
-
-  if (idum < 0 || iff == 0) {
-    iff=1;
-    mj=fabs(MSEED-(idum < 0 ? -idum : idum));
-    mj %= MBIG;
-    ma[55]=mj;
-    mk=1;
-    for (i=1;i<=54;i++) {
-      ii=(21*i) % 55;
-      ma[ii]=mk;
-      mk=mj-mk;
-      if (mk < MZ) mk += MBIG;
-      mj=ma[ii];
-    }
-    for (k=1;k<=4;k++)
-      for (i=1;i<=55;i++) {
-        ma[i] -= ma[1+(i+30) % 55];
-        if (ma[i] < MZ) ma[i] += MBIG;
-      }
-    inext=0;
-    inextp=31;
-    idum=1;
+  uint32_t c0 = (uint32_t)n, c1 = (uint32_t)(n >> 32);
+  uint32_t c2 = (uint32_t)stream, c3 = (uint32_t)(stream >> 32);
+  uint32_t k0 = (uint32_t)philox_key, k1 = (uint32_t)(philox_key >> 32);
+  int round;
+
+  for (round = 0; round < 10; round++) {
+    uint64_t p0 = (uint64_t)0xD2511F53u * c0;
+    uint64_t p1 = (uint64_t)0xCD9E8D57u * c2;
+    uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+    uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+    c1 = (uint32_t)p1;
+    c3 = (uint32_t)p0;
+    c0 = n0;
+    c2 = n2;
+    k0 += 0x9E3779B9u;
+    k1 += 0xBB67AE85u;
   }
-  if (++inext == 56) inext=1;
-  if (++inextp == 56) inextp=1;
-  mj=ma[inext]-ma[inextp];
-  if (mj < MZ) mj += MBIG;
-  ma[inext]=mj;
-  return mj*FAC;
+  out[0] = ((uint64_t)c1 << 32) | c0;
+  out[1] = ((uint64_t)c3 << 32) | c2;
 }
 
-#undef MBIG
-#undef MSEED
-#undef MZ
-#undef FAC
+/* The next number of the stream, as a double in [0,1) */
+static double philox_double(PhiloxStream *s, uint64_t stream)
+{
+  uint64_t n = s->position / 2;
+  if (n != s->cached) {
+    philox(stream, n, s->block);
+    s->cached = n;
+  }
+  return (double)(s->block[s->position++ % 2] >> 11) * (1.0 / 9007199254740992.0);
+}
 
+static void philox_reset(PhiloxStream *s)
+{
+  s->position = 0;
+  s->cached = ~(uint64_t)0;
+}
 
-#define M 714025
-#define IA 1366
-#define IC 150889
+double uniform()
+{
+  return philox_double(&stream_uniform, 0);
+}
 
 double ran2()
 {
-  static long iy,ir[98];
-  static int iff=0;
-  int j;
-
-  if (idum2 < 0 || iff == 0) {
-    iff=1;
-    if ((idum2=(IC-(idum2)) % M) < 0) idum2 = -(idum2);
-    for (j=1;j<=97;j++) {
-      idum2=(IA*(idum2)+IC) % M;
-      ir[j]=(idum2);
-    }
-    idum2=(IA*(idum2)+IC) % M;
-    iy=(idum2);
-  }
-  j=1 + 97.0*iy/M;
-  if (j > 97 || j < 1) printf("\nRAN2: This cannot happen.\n");
-  iy=ir[j];
-  idum2=(IA*(idum2)+IC) % M;
-  ir[j]=(idum2);
-  return (double) iy/M;
+  return philox_double(&stream_ran2, 1);
 }
 
-#undef M
-#undef IA
-#undef IC
-
 double gasdev()
 /* see Numerical Recipes */
 {
@@ -99,7 +80,7 @@ double gasdev()
       v1=2.0*uniform()-1.0;
       v2=2.0*uniform()-1.0;
       r=v1*v1+v2*v2;
-    } while (r >= 1.0);
+    } while (r >= 1.0 || r == 0.0);
     fac=sqrt(-2.0*log(r)/r);
     gset=v1*fac;
     iset=1;
@@ -141,11 +122,10 @@ double normal(double mean,double stdev)
 int set_seed(int seed)
 {
   int i;
-  idum = -seed;
-  idum2 = -seed;
+  philox_key = (uint64_t)(unsigned)seed;
+  philox_reset(&stream_uniform);
+  philox_reset(&stream_ran2);
   iseed = seed;
-  for (i=0; i<100; i++)
-    uniform();
   for (i=0; i<100; i++)
     boolean();
   return seed;
@@ -0,0 +1,111 @@
+/*
+  SweepDraws holds the random numbers that a sweep needs for each of
+  its draws: the site (row,col), a neighbor (1 to 8) and a probability
+  in [0,1). They are generated in bulk with CounterRng::fill() and
+  converted in simple loops, instead of four calls into the generator
+  and the <random> distributions per draw.
+
+  Each draw uses two 64-bit numbers. The row and the column are the
+  high and the low 32 bits of the first one, scaled to the grid with a
+  multiplication (the bias is below n/2^32). The neighbor is the top 3
+  bits of the second one and the probability its low 53 bits, both
+  exactly uniform.
+
+  The draws are converted BLOCK at a time as the sweep advances, so the
+  buffers stay in the cache whatever the size of the grid. The numbers
+  of the whole sweep are reserved in the generator when it starts, so
+  the draws, and the numbers the generator gives during the sweep, are
+  the same as if they had all been drawn at once.
+
+  ------------------------------------------------------------
+  Methods:
+
+  start(rng,n,nrow,ncol): starts a sweep of n sites of an nrow x ncol
+  grid (rows and columns start at 1). rng moves past the 2n numbers of
+  the sweep.
+
+  next_block(): converts the next draws of the sweep and returns their
+  number, at most BLOCK, 0 once the sweep is over.
+
+  row(i), col(i), nei(i), p(i): the numbers of the i-th draw of the
+  current block.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "counter-rng.hpp"
+
+#ifndef SWEEP_DRAWS
+#define SWEEP_DRAWS
+
+class SweepDraws {
+
+public:
+  static const std::size_t BLOCK = 8192;
+
+private:
+  CounterRng sites; // The first numbers of the draws left
+  CounterRng events; // Their second numbers
+  std::size_t left = 0;
+  unsigned n_row = 0;
+  unsigned n_col = 0;
+
+  std::vector<std::uint64_t> raw;
+  std::vector<unsigned> rows;
+  std::vector<unsigned> cols;
+  std::vector<unsigned> neis;
+  std::vector<double> probs;
+
+public:
+  inline void start(CounterRng& rng,const std::size_t n,const unsigned nrow,const unsigned ncol);
+  inline std::size_t next_block();
+
+  unsigned row(const std::size_t i) const {return rows[i];}
+  unsigned col(const std::size_t i) const {return cols[i];}
+  unsigned nei(const std::size_t i) const {return neis[i];}
+  double p(const std::size_t i) const {return probs[i];}
+};
+
+void SweepDraws::start(CounterRng& rng,const std::size_t n,const unsigned nrow,const unsigned ncol)
+{
+  sites = rng;
+  events = rng;
+  events.discard(n);
+  rng.discard(2*n);
+  left = n;
+  n_row = nrow;
+  n_col = ncol;
+
+  const std::size_t size = (n < BLOCK) ? n : BLOCK;
+  if(rows.size() < size){
+    raw.resize(2*size);
+    rows.resize(size);
+    cols.resize(size);
+    neis.resize(size);
+    probs.resize(size);
+  }
+}
+
+std::size_t SweepDraws::next_block()
+{
+  const std::size_t n = (left < BLOCK) ? left : BLOCK;
+  left -= n;
+  sites.fill(raw.data(),n);
+  events.fill(raw.data() + n,n);
+
+  const std::uint64_t* site = raw.data();
+  const std::uint64_t* event = raw.data() + n;
+  for(std::size_t i = 0; i < n; ++i){
+    rows[i] = 1 + static_cast<unsigned>(((site[i] >> 32) * n_row) >> 32);
+    cols[i] = 1 + static_cast<unsigned>(((site[i] & 0xFFFFFFFFu) * n_col) >> 32);
+  }
+  for(std::size_t i = 0; i < n; ++i){
+    neis[i] = 1 + static_cast<unsigned>(event[i] >> 61);
+    probs[i] = static_cast<double>(event[i] & ((static_cast<std::uint64_t>(1) << 53) - 1)) * (1.0 / 9007199254740992.0);
+  }
+  return n;
+}
+
+#endif
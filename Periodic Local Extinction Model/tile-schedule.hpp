@@ -0,0 +1,140 @@
+/*
+  TileSchedule cuts a toroidal grid into rectangular tiles that can be
+  updated at the same time by different threads.
+
+  An update of a cell reads and writes the cells and the public-goods
+  sums at most halo cells away from it: a move or a birth changes a
+  cell at distance 1, and the public goods of a changed cell are
+  summed over its neighborhood of radius R, so halo = R+1 (3 for the
+  5x5 neighborhood). Updates of two cells more than 2*halo apart are
+  therefore independent.
+
+  The tiles form an even number of rows and of columns, so that the
+  torus can be colored like a checkerboard with 4 colors: two tiles of
+  the same color are separated by at least one whole tile. Tiles are at
+  least 2*halo cells wide, so all the tiles of one color can be
+  updated in parallel.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  nrow, ncol: the size of the grid.
+
+  side: the wanted side of a tile, raised to 2*halo if smaller. The
+  actual sides are close to it, rounded so that the number of tiles is
+  even in both directions. A grid smaller than 4*halo in either
+  direction cannot be cut and is an error.
+
+  halo: the distance from an updated cell at which the update may read
+  or write, HALO by default.
+
+  ------------------------------------------------------------
+  Methods:
+
+  size(): the number of tiles.
+
+  of_color(c): the tiles of color c (0 <= c < 4).
+
+  first_row(tile), last_row(tile), first_col(tile), last_col(tile):
+  the cells of the tile, both ends included (rows and columns start
+  at 1).
+
+  area(tile): the number of cells of the tile.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#ifndef TILE_SCHEDULE
+#define TILE_SCHEDULE
+
+class TileSchedule {
+
+private:
+  std::vector<unsigned> row_edge; // Tile row i covers rows [row_edge[i]+1,row_edge[i+1]]
+  std::vector<unsigned> col_edge;
+  std::vector<unsigned> color_members[4];
+
+  inline static std::vector<unsigned> cut(const unsigned n,const unsigned side,const unsigned min_side);
+
+public:
+  static const unsigned HALO = 3;
+
+  inline TileSchedule(const unsigned nrow,const unsigned ncol,const unsigned side,const unsigned halo = HALO);
+
+  inline unsigned size() const;
+  inline const std::vector<unsigned>& of_color(const unsigned c) const;
+  inline unsigned first_row(const unsigned tile) const;
+  inline unsigned last_row(const unsigned tile) const;
+  inline unsigned first_col(const unsigned tile) const;
+  inline unsigned last_col(const unsigned tile) const;
+  inline unsigned area(const unsigned tile) const;
+};
+
+TileSchedule::TileSchedule(const unsigned nrow,const unsigned ncol,const unsigned side,const unsigned halo)
+  : row_edge(cut(nrow,side,2*halo)),
+    col_edge(cut(ncol,side,2*halo))
+{
+  const unsigned n_tile_col = col_edge.size() - 1;
+  for(unsigned tile = 0; tile < size(); ++tile){
+    const unsigned color = 2*((tile / n_tile_col) % 2) + (tile % n_tile_col) % 2;
+    color_members[color].push_back(tile);
+  }
+}
+
+/* Edges of an even number of tiles of about the given side, and of at
+   least min_side */
+std::vector<unsigned> TileSchedule::cut(const unsigned n,const unsigned side,const unsigned min_side)
+{
+  const unsigned wanted = std::max(side,min_side);
+  unsigned n_tile = 2 * ((wanted > 0) ? n / (2*wanted) : 0);
+  if(n_tile < 2)
+    n_tile = 2;
+  if(n / n_tile < min_side){
+    std::cerr << "TileSchedule() Error: a grid of " << n << " cells cannot be cut into tiles of at least " << min_side << " cells." << std::endl;
+    exit(-1);
+  }
+  std::vector<unsigned> edge(n_tile+1);
+  for(unsigned i = 0; i <= n_tile; ++i)
+    edge[i] = static_cast<unsigned>(static_cast<unsigned long>(i) * n / n_tile);
+  return edge;
+}
+
+unsigned TileSchedule::size() const
+{
+  return (row_edge.size() - 1) * (col_edge.size() - 1);
+}
+
+const std::vector<unsigned>& TileSchedule::of_color(const unsigned c) const
+{
+  return color_members[c];
+}
+
+unsigned TileSchedule::first_row(const unsigned tile) const
+{
+  return row_edge[tile / (col_edge.size() - 1)] + 1;
+}
+
+unsigned TileSchedule::last_row(const unsigned tile) const
+{
+  return row_edge[tile / (col_edge.size() - 1) + 1];
+}
+
+unsigned TileSchedule::first_col(const unsigned tile) const
+{
+  return col_edge[tile % (col_edge.size() - 1)] + 1;
+}
+
+unsigned TileSchedule::last_col(const unsigned tile) const
+{
+  return col_edge[tile % (col_edge.size() - 1) + 1];
+}
+
+unsigned TileSchedule::area(const unsigned tile) const
+{
+  return (last_row(tile) - first_row(tile) + 1) * (last_col(tile) - first_col(tile) + 1);
+}
+
+#endif
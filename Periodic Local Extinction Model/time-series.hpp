@@ -0,0 +1,432 @@
+/*
+  TimeSeriesWriter writes the records of an output file (a time step
+  and the statistics of the population) through a large buffer, and
+  TimeSeriesReader reads back the binary files it writes.
+
+  The records are written as text, in the same csv format as an
+  std::ofstream with its default precision, or as fixed-width binary
+  records that a program can read without parsing them. The buffer is
+  written to the file when it is full and at the latest flush_seconds
+  after the first record it holds: a crash loses at most the records of
+  the last seconds, and never leaves a record half written in a text
+  file that is then resumed (see openOutput() in main.cpp).
+
+  ------------------------------------------------------------
+  Binary format:
+
+  The file holds only the records, one after the other, each column in
+  8 bytes: an unsigned integer (uint64) or a floating point number
+  (float64), in the byte order of the machine that wrote the file. The
+  schema is written next to it, in file_name.json:
+
+  {"format": "cash-time-series", "version": 1, "byte_order": "little",
+   "record_size": 24, "columns": [{"name": "TimeStep", "type": "float64",
+   "offset": 0}, ...]}
+
+  so that, for example, numpy.fromfile() can read the file with a
+  structured dtype. A file cut by a crash may end with a partial record,
+  which is ignored when the file is read.
+
+  ------------------------------------------------------------
+  TimeSeriesWriter
+
+  Constructer:
+
+  Takes no argument, the file is given to open().
+
+  Methods:
+
+  open(file_name,columns,types,format,append,flush_seconds=10):
+
+  columns: the names of the columns, separated by commas, as in the
+  header of the csv file.
+
+  types: one letter per column, u for an unsigned integer and f for a
+  floating point number.
+
+  format: CSV or BINARY.
+
+  append: whether to add the records to the end of an existing file
+  instead of creating it (with its header line in CSV).
+
+  writer << value:
+
+  Adds the value of the next column of the current record, an unsigned
+  for a u column or a double for an f column. The record ends with its
+  last column. A value of the wrong type prints a message and
+  terminates the program.
+
+  size(): the size of the file in bytes, counting the records still in
+  the buffer.
+
+  flush(): writes the buffer to the file.
+
+  close(): flushes and closes the file. The destructor closes it too.
+
+  ------------------------------------------------------------
+  TimeSeriesReader
+
+  Constructer:
+
+  file_name: a binary time series, mapped into memory, and its schema
+  in file_name.json.
+
+  Methods:
+
+  get_n_records(), get_n_columns(): the size of the table.
+
+  get_name(c), get_type(c): the name and the type (u or f) of column c.
+
+  index(name): the number of the column name.
+
+  value<T>(n,c): the value of column c in record n, T being
+  std::uint64_t or double as the type of the column.
+
+  column<T>(name): the values of a column in all the records.
+
+  A missing or inconsistent file prints a message and terminates the
+  program.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef TIME_SERIES
+#define TIME_SERIES
+
+namespace TimeSeriesFile {
+  const char FORMAT[] = "cash-time-series";
+  const unsigned VERSION = 1;
+
+  // Bytes of a column in a binary record
+  const std::size_t COLUMN_SIZE = 8;
+
+  inline const char* byte_order() {const std::uint16_t one = 1; return (*reinterpret_cast<const unsigned char*>(&one) == 1) ? "little" : "big";}
+  inline std::string schema_name(const std::string& file_name) {return file_name + ".json";}
+}
+
+class TimeSeriesWriter {
+
+public:
+  enum Format {CSV, BINARY};
+
+private:
+  // The buffer is written when less than this is left in it
+  static const std::size_t BUFFER_SIZE = 1 << 20;
+  static const std::size_t MAX_FIELD = 32;
+
+  std::string file_name;
+  std::FILE* file;
+  Format format;
+  std::string types;
+  unsigned next_column;
+
+  std::vector<char> buffer;
+  std::size_t used;
+  std::uint64_t flushed_size;
+
+  std::chrono::steady_clock::duration flush_interval;
+  std::chrono::steady_clock::time_point flush_time;
+
+  inline void check_column(const char type);
+  inline void end_field();
+  inline void write_schema(const std::string& columns) const;
+
+  TimeSeriesWriter(const TimeSeriesWriter& rhs);
+  void operator=(const TimeSeriesWriter& rhs);
+
+public:
+  inline TimeSeriesWriter();
+  ~TimeSeriesWriter() {close();}
+
+  inline void open(const std::string& a_file_name,const std::string& columns,const std::string& a_types,const Format a_format,const bool append,const double flush_seconds=10.0);
+
+  inline TimeSeriesWriter& operator<<(const double value);
+  inline TimeSeriesWriter& operator<<(const unsigned value);
+
+  std::uint64_t size() const {return flushed_size + used;}
+  inline void flush();
+  inline void close();
+};
+
+TimeSeriesWriter::TimeSeriesWriter()
+  : file(nullptr),
+    format(CSV),
+    next_column(0),
+    buffer(BUFFER_SIZE),
+    used(0),
+    flushed_size(0)
+{
+}
+
+void TimeSeriesWriter::open(const std::string& a_file_name,const std::string& columns,const std::string& a_types,const Format a_format,const bool append,const double flush_seconds)
+{
+  close();
+  file_name = a_file_name;
+  format = a_format;
+  types = a_types;
+  next_column = 0;
+  if(types.empty() || types.find_first_not_of("uf") != std::string::npos || static_cast<std::size_t>(std::count(columns.begin(),columns.end(),',')) + 1 != types.size()){
+    std::cerr << "TimeSeriesWriter::open() Error: the columns " << columns << " do not match the types " << types << std::endl;
+    exit(-1);
+  }
+  file = std::fopen(file_name.c_str(),append ? "ab" : "wb");
+  if(file == nullptr){
+    std::cerr << "TimeSeriesWriter::open() Error: cannot open " << file_name << std::endl;
+    exit(-1);
+  }
+  std::setvbuf(file,nullptr,_IONBF,0);
+  std::fseek(file,0,SEEK_END);
+  flushed_size = std::ftell(file);
+  flush_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(flush_seconds));
+  flush_time = std::chrono::steady_clock::now() + flush_interval;
+
+  if(format == BINARY){
+    write_schema(columns);
+  }else if(!append){
+    std::memcpy(buffer.data(),columns.data(),columns.size());
+    used = columns.size();
+    buffer[used++] = '\n';
+  }
+}
+
+// The schema of a binary file, which does not change when it is appended to
+void TimeSeriesWriter::write_schema(const std::string& columns) const
+{
+  std::ofstream schema(TimeSeriesFile::schema_name(file_name).c_str());
+  schema << "{\"format\": \"" << TimeSeriesFile::FORMAT << "\", \"version\": " << TimeSeriesFile::VERSION
+         << ", \"byte_order\": \"" << TimeSeriesFile::byte_order() << "\", \"record_size\": " << types.size()*TimeSeriesFile::COLUMN_SIZE
+         << ", \"columns\": [";
+  std::stringstream names(columns);
+  std::string name;
+  for(unsigned c = 0; std::getline(names,name,','); ++c){
+    schema << ((c > 0) ? ", " : "") << "{\"name\": \"" << name << "\", \"type\": \"" << ((types[c] == 'u') ? "uint64" : "float64")
+           << "\", \"offset\": " << c*TimeSeriesFile::COLUMN_SIZE << "}";
+  }
+  schema << "]}\n";
+  if(!schema){
+    std::cerr << "TimeSeriesWriter::open() Error: cannot write " << TimeSeriesFile::schema_name(file_name) << std::endl;
+    exit(-1);
+  }
+}
+
+void TimeSeriesWriter::check_column(const char type)
+{
+  if(file == nullptr || types[next_column] != type){
+    std::cerr << "TimeSeriesWriter Error: " << file_name << ": a value of type " << type << " given for column " << next_column << std::endl;
+    exit(-1);
+  }
+}
+
+// After a value: the separator in CSV, and the end of the record after the last column
+void TimeSeriesWriter::end_field()
+{
+  ++next_column;
+  const bool end_record = (next_column == types.size());
+  if(format == CSV)
+    buffer[used++] = end_record ? '\n' : ',';
+  if(!end_record)
+    return;
+  next_column = 0;
+  if(used > BUFFER_SIZE - types.size()*MAX_FIELD)
+    flush();
+  else if(std::chrono::steady_clock::now() >= flush_time)
+    flush();
+}
+
+TimeSeriesWriter& TimeSeriesWriter::operator<<(const double value)
+{
+  check_column('f');
+  if(used == 0)
+    flush_time = std::chrono::steady_clock::now() + flush_interval;
+  if(format == CSV){
+    // The text of std::ostream with its default precision
+    used += std::snprintf(&buffer[used],MAX_FIELD,"%g",value);
+  }else{
+    std::memcpy(&buffer[used],&value,TimeSeriesFile::COLUMN_SIZE);
+    used += TimeSeriesFile::COLUMN_SIZE;
+  }
+  end_field();
+  return *this;
+}
+
+TimeSeriesWriter& TimeSeriesWriter::operator<<(const unsigned value)
+{
+  check_column('u');
+  if(used == 0)
+    flush_time = std::chrono::steady_clock::now() + flush_interval;
+  if(format == CSV){
+    char digits[MAX_FIELD];
+    unsigned n = 0;
+    unsigned rest = value;
+    do{
+      digits[n++] = '0' + rest % 10;
+      rest /= 10;
+    }while(rest > 0);
+    while(n > 0)
+      buffer[used++] = digits[--n];
+  }else{
+    const std::uint64_t wide = value;
+    std::memcpy(&buffer[used],&wide,TimeSeriesFile::COLUMN_SIZE);
+    used += TimeSeriesFile::COLUMN_SIZE;
+  }
+  end_field();
+  return *this;
+}
+
+void TimeSeriesWriter::flush()
+{
+  if(file == nullptr || used == 0)
+    return;
+  if(std::fwrite(buffer.data(),1,used,file) != used){
+    std::cerr << "TimeSeriesWriter::flush() Error: cannot write " << file_name << std::endl;
+    exit(-1);
+  }
+  flushed_size += used;
+  used = 0;
+}
+
+void TimeSeriesWriter::close()
+{
+  if(file == nullptr)
+    return;
+  flush();
+  std::fclose(file);
+  file = nullptr;
+}
+
+
+class TimeSeriesReader {
+
+private:
+  std::string file_name;
+  std::vector<std::string> names;
+  std::string types;
+  std::size_t record_size;
+  std::size_t n_records;
+
+  void* mapping;
+  std::size_t mapping_size;
+
+  inline void read_schema();
+  inline void error(const std::string& message) const;
+
+  TimeSeriesReader(const TimeSeriesReader& rhs);
+  void operator=(const TimeSeriesReader& rhs);
+
+public:
+  inline explicit TimeSeriesReader(const std::string& a_file_name);
+  inline ~TimeSeriesReader();
+
+  std::size_t get_n_records() const {return n_records;}
+  unsigned get_n_columns() const {return types.size();}
+  const std::string& get_name(const unsigned c) const {return names[c];}
+  char get_type(const unsigned c) const {return types[c];}
+  inline unsigned index(const std::string& name) const;
+
+  template <class T> inline T value(const std::size_t n,const unsigned c) const;
+  template <class T> inline std::vector<T> column(const std::string& name) const;
+};
+
+TimeSeriesReader::TimeSeriesReader(const std::string& a_file_name)
+  : file_name(a_file_name),
+    record_size(0),
+    n_records(0),
+    mapping(MAP_FAILED),
+    mapping_size(0)
+{
+  read_schema();
+  const int fd = ::open(file_name.c_str(),O_RDONLY);
+  struct stat info;
+  if(fd < 0 || fstat(fd,&info) != 0)
+    error("cannot open the file");
+  mapping_size = info.st_size;
+  n_records = mapping_size / record_size;
+  if(mapping_size > 0)
+    mapping = mmap(nullptr,mapping_size,PROT_READ,MAP_PRIVATE,fd,0);
+  ::close(fd);
+  if(mapping_size > 0 && mapping == MAP_FAILED)
+    error("cannot map the file");
+}
+
+TimeSeriesReader::~TimeSeriesReader()
+{
+  if(mapping != MAP_FAILED)
+    munmap(mapping,mapping_size);
+}
+
+void TimeSeriesReader::error(const std::string& message) const
+{
+  std::cerr << "TimeSeriesReader Error: " << file_name << ": " << message << std::endl;
+  exit(-1);
+}
+
+// Reads back the schema written by TimeSeriesWriter, not any json file
+void TimeSeriesReader::read_schema()
+{
+  std::ifstream file(TimeSeriesFile::schema_name(file_name).c_str());
+  std::stringstream ss;
+  ss << file.rdbuf();
+  const std::string schema = ss.str();
+  if(!file || schema.find(std::string("\"format\": \"") + TimeSeriesFile::FORMAT + "\"") == std::string::npos)
+    error("no schema");
+  if(schema.find(std::string("\"byte_order\": \"") + TimeSeriesFile::byte_order() + "\"") == std::string::npos)
+    error("written in another byte order");
+
+  const std::string name_key = "{\"name\": \"";
+  const std::string type_key = "\"type\": \"";
+  for(std::size_t position = schema.find(name_key); position != std::string::npos; position = schema.find(name_key,position)){
+    position += name_key.size();
+    const std::size_t name_end = schema.find('"',position);
+    const std::size_t type_start = schema.find(type_key,name_end);
+    if(name_end == std::string::npos || type_start == std::string::npos)
+      error("bad schema");
+    names.push_back(schema.substr(position,name_end - position));
+    types.push_back((schema.compare(type_start + type_key.size(),6,"uint64") == 0) ? 'u' : 'f');
+  }
+  record_size = types.size()*TimeSeriesFile::COLUMN_SIZE;
+  if(record_size == 0 || schema.find("\"record_size\": " + std::to_string(record_size) + ",") == std::string::npos)
+    error("bad schema");
+}
+
+unsigned TimeSeriesReader::index(const std::string& name) const
+{
+  for(unsigned c = 0; c < names.size(); ++c){
+    if(names[c] == name)
+      return c;
+  }
+  error("no column " + name);
+  return 0;
+}
+
+template <class T> T TimeSeriesReader::value(const std::size_t n,const unsigned c) const
+{
+  static_assert(sizeof(T) == TimeSeriesFile::COLUMN_SIZE,"a column is read as std::uint64_t or double");
+  T result;
+  std::memcpy(&result,static_cast<const unsigned char*>(mapping) + n*record_size + c*TimeSeriesFile::COLUMN_SIZE,sizeof(T));
+  return result;
+}
+
+template <class T> std::vector<T> TimeSeriesReader::column(const std::string& name) const
+{
+  const unsigned c = index(name);
+  std::vector<T> values(n_records);
+  for(std::size_t n = 0; n < n_records; ++n)
+    values[n] = value<T>(n,c);
+  return values;
+}
+
+#endif
@@ -0,0 +1,206 @@
+/*
+  ActiveSites keeps the set of cells of a grid where an update can
+  change something. A cell is active when it is alive (it can die or
+  move) or when at least one of its 8 neighbors is alive (a neighbor
+  can reproduce into it). An empty cell surrounded by empty cells is
+  inactive: drawing it in the sweep picks an empty neighbor and
+  nothing happens.
+
+  The set is maintained incrementally, in the same way as
+  PublicGoodsField: for every cell it remembers whether the cell was
+  registered alive and how many of its neighbors are alive.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  nrow, ncol: the size of the grid it follows.
+
+  The argument to the template, <G>, is the grid type, either
+  CA2D<Automaton> or AutomatonPlanes. G::cell(row,col) must give
+  access to get_state() (0 means dead).
+
+  ------------------------------------------------------------
+  Methods:
+
+  rebuild(ca):
+
+  Recomputes the set from scratch.
+
+  refresh(ca,row,col):
+
+  Must be called after the cell at (row,col) has been born, has died
+  or has been swapped. Calling it on a cell whose state did not
+  change between dead and alive costs nothing.
+
+  size(): the number of active cells.
+
+  pick(rng,row,col): sets (row,col) to an active cell chosen
+  uniformly at random. The set must not be empty.
+
+  is_active(row,col): whether (row,col) is in the set.
+
+  get_order(order), set_order(order):
+
+  The cells of the set, as offsets (row-1)*ncol+(col-1), in the order
+  used by pick(), which depends on the history of the set. Restoring it
+  after a rebuild() makes pick() draw the same cells as the saved set.
+  The order must hold exactly the active cells.
+*/
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "site-set.hpp"
+
+#ifndef ACTIVE_SITES
+#define ACTIVE_SITES
+
+template <class G> class ActiveSites {
+
+private:
+  unsigned nrow;
+  unsigned ncol;
+
+  /* Whether each cell is registered alive, and how many of its 8
+     neighbors are registered alive */
+  std::vector<unsigned char> alive;
+  std::vector<unsigned char> n_alive_nei;
+
+  SiteSet active;
+
+  inline unsigned offset(const unsigned row,const unsigned col) const;
+  inline unsigned wrap_row(const int row) const;
+  inline unsigned wrap_col(const int col) const;
+  inline void update(const unsigned ind);
+
+public:
+  inline ActiveSites(const unsigned a_nrow,const unsigned a_ncol);
+
+  inline void rebuild(const G& ca);
+  inline void refresh(const G& ca,const unsigned row,const unsigned col);
+
+  inline unsigned size() const;
+  template <class RNG> inline void pick(RNG& rng,unsigned& row,unsigned& col) const;
+  inline bool is_active(const unsigned row,const unsigned col) const;
+
+  inline void get_order(std::vector<unsigned>& order) const;
+  inline void set_order(const std::vector<unsigned>& order);
+};
+
+template <class G> ActiveSites<G>::ActiveSites(const unsigned a_nrow,const unsigned a_ncol)
+  : nrow(a_nrow),
+    ncol(a_ncol),
+    alive(a_nrow*a_ncol,0),
+    n_alive_nei(a_nrow*a_ncol,0),
+    active(a_nrow*a_ncol)
+{
+  if(nrow==0 || ncol==0){
+    std::cerr << "ActiveSites() Error: nrow=ncol=0 is not allowed." << std::endl;
+  }
+}
+
+/* Rows and columns [1,n] are mapped to [0,n-1] */
+template <class G> unsigned ActiveSites<G>::offset(const unsigned row,const unsigned col) const
+{
+  return (row-1)*ncol + (col-1);
+}
+
+/* Same wrapping as CA2D::xy_neigh_wrap() */
+template <class G> unsigned ActiveSites<G>::wrap_row(const int row) const
+{
+  if(row <= 0) return nrow + row;
+  if(row > static_cast<int>(nrow)) return row - nrow;
+  return row;
+}
+
+template <class G> unsigned ActiveSites<G>::wrap_col(const int col) const
+{
+  if(col <= 0) return ncol + col;
+  if(col > static_cast<int>(ncol)) return col - ncol;
+  return col;
+}
+
+template <class G> void ActiveSites<G>::update(const unsigned ind)
+{
+  if(alive[ind] || n_alive_nei[ind] > 0)
+    active.insert(ind);
+  else
+    active.erase(ind);
+}
+
+template <class G> void ActiveSites<G>::rebuild(const G& ca)
+{
+  std::fill(alive.begin(),alive.end(),0);
+  std::fill(n_alive_nei.begin(),n_alive_nei.end(),0);
+  active.clear();
+  for(unsigned row = 1; row <= nrow; ++row){
+    for(unsigned col = 1; col <= ncol; ++col){
+      refresh(ca,row,col);
+    }
+  }
+}
+
+template <class G> void ActiveSites<G>::refresh(const G& ca,const unsigned row,const unsigned col)
+{
+  const unsigned ind = offset(row,col);
+  const unsigned char now_alive = (ca.cell(row,col).get_state() != 0) ? 1 : 0;
+  if(now_alive == alive[ind])
+    return;
+
+  alive[ind] = now_alive;
+  update(ind);
+  for(int r = static_cast<int>(row) - 1; r <= static_cast<int>(row) + 1; ++r){
+    for(int c = static_cast<int>(col) - 1; c <= static_cast<int>(col) + 1; ++c){
+      if(r == static_cast<int>(row) && c == static_cast<int>(col))
+        continue;
+      const unsigned nei = offset(wrap_row(r),wrap_col(c));
+      n_alive_nei[nei] = static_cast<unsigned char>(now_alive ? n_alive_nei[nei] + 1 : n_alive_nei[nei] - 1);
+      update(nei);
+    }
+  }
+}
+
+template <class G> unsigned ActiveSites<G>::size() const
+{
+  return active.size();
+}
+
+template <class G> template <class RNG> void ActiveSites<G>::pick(RNG& rng,unsigned& row,unsigned& col) const
+{
+  const unsigned ind = active.pick(rng);
+  row = ind / ncol + 1;
+  col = ind % ncol + 1;
+}
+
+template <class G> bool ActiveSites<G>::is_active(const unsigned row,const unsigned col) const
+{
+  return active.contains(offset(row,col));
+}
+
+template <class G> void ActiveSites<G>::get_order(std::vector<unsigned>& order) const
+{
+  order.resize(active.size());
+  for(unsigned i = 0; i < active.size(); ++i)
+    order[i] = active.at(i);
+}
+
+template <class G> void ActiveSites<G>::set_order(const std::vector<unsigned>& order)
+{
+  const unsigned n_active = active.size();
+  bool valid = (order.size() == n_active);
+  for(unsigned i = 0; valid && i < order.size(); ++i)
+    valid = (order[i] < alive.size() && active.contains(order[i]));
+  if(valid){
+    active.clear();
+    for(unsigned i = 0; i < order.size(); ++i)
+      active.insert(order[i]);
+  }
+  // A repeated cell is only inserted once
+  if(!valid || active.size() != n_active){
+    std::cerr << "ActiveSites::set_order() Error: the order does not hold the active cells." << std::endl;
+    exit(-1);
+  }
+}
+
+#endif
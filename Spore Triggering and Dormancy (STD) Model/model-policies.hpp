@@ -0,0 +1,190 @@
+/*
+  Policies that tell the variants of the model apart. Simulation (see
+  simulation.hpp) takes a Model with four of them as a template
+  parameter, so the choices are made at compile time and the update
+  loop of each variant holds no test of the variant. The Model of a
+  folder is set in model.hpp.
+
+  ------------------------------------------------------------
+  Mutation policies:
+
+  var: standard deviation of the normal deviate delta.
+
+  mutate(p,delta): the trait p of a parent mutated by delta, in [0,1].
+
+  ExponentialMutation: p*exp(-delta), clamped to [0,1].
+  LinearMutation: p+delta, reflected back into [0,1].
+
+  ------------------------------------------------------------
+  Perturbation policies:
+
+  KILLS: whether cells are killed every INTERVAL time units (the time
+  of the last killing is then saved in the checkpoints).
+
+  LIVE_INDEX: whether Simulation keeps an index of the live cells, that
+  the killing draws from.
+
+  NoKill: the population is left alone.
+  BoxKill: every cell of a box dies, by default the middle half of the
+  grid, from row n_row/4 to 3*n_row/4 and column n_col/4 to 3*n_col/4
+  (25 to 75 on the 100x100 grid). default_box(n) gives its first and
+  last index along a side of n cells.
+  RandomKill: a FRACTION of the live cells, drawn at random, die.
+
+  ------------------------------------------------------------
+  Neighborhood policies:
+
+  LOCAL: whether the offspring of a cell and the public goods it
+  perceives come from its neighborhood. Simulation then keeps the
+  public goods field of the grid, and every engine can run the model.
+
+  CONTRIBUTIONS: whether Simulation follows the public goods that each
+  system receives from the other one (the K columns of cell_states and
+  the file contribution_states).
+
+  Local: the parent of an offspring is a random one of the 8 neighbors
+  of the empty cell, and it perceives the average k of its
+  neighborhood of radius --radius (5x5 by default).
+  WellMixed: the parent is drawn anywhere on the grid, and perceives the
+  mean k of the whole population, found as set by MeanK. Only the sweep
+  engine runs it.
+
+  MeanK: GRID_SAMPLE estimates the mean k from N_SAMPLE sites drawn on
+  the grid, the dead ones skipped; EXACT reads it from the population
+  statistics; LIVE_SAMPLE estimates it from N_SAMPLE live cells.
+
+  ------------------------------------------------------------
+  Systems policies:
+
+  LINEAGE: whether the cells carry the tag of the type of their
+  ancestor at the start of the run, counted in ancestor_states.
+
+  OUTPUT_INTERVAL: steps between two lines of the output files.
+  RESCAN_INTERVAL: default steps between two scans of the grid for the
+  statistics (see --rescan).
+  RUNTIME: steps of a run, 0 when it is given on the command line.
+
+  seed(cell,rng): state of a cell of a grid drawn at random.
+  extinct(stats): whether the population of ByState statistics stats
+  has died out, which ends the run.
+
+  OneSystem: the DOL system alone, cells of type a (state 1) and b
+  (state 2) that produce offspring of either type.
+  TwoSystems: the DOL system in competition with system p, whose cells
+  of type a (state 3) and b (state 4) do not differentiate. A grid
+  drawn at random holds system p only, so the runs start from a file.
+*/
+
+#include <cmath>
+#include <random>
+
+#ifndef MODELPOLICIES
+#define MODELPOLICIES
+
+struct ExponentialMutation {
+  static constexpr double var = 0.02; //Standard deviation of Variables variation
+  static double mutate(double p, double delta) {
+    double p_prime = p * std::exp(-delta);
+    if (p_prime > 1.0) {
+      p_prime = 1.0;
+    }
+    else if (p_prime < 0.0) {
+      p_prime = 0.0;
+    }
+    return p_prime;
+  }
+};
+
+struct LinearMutation {
+  static constexpr double var = 0.002; //standard deviation of variable variation
+  static double mutate(double p, double delta) {
+    double p_prime = p + delta;
+
+    // Ensure p_prime stays within [0, 1] by reflecting it back into the range
+    if (p_prime < 0.0) {
+      p_prime = -p_prime;  // Reflect negative values to positive
+    }
+    if (p_prime > 1.0) {
+      p_prime = 2.0 - p_prime;  // Reflect values greater than 1 back into the range
+    }
+
+    // Final check to clamp within bounds in case of edge cases
+    if (p_prime > 1.0) {
+      p_prime = 1.0;
+    } else if (p_prime < 0.0) {
+      p_prime = 0.0;
+    }
+    return p_prime;
+  }
+};
+
+struct NoKill {
+  static const bool KILLS = false;
+  static const bool LIVE_INDEX = false;
+  static const unsigned INTERVAL = 0;
+};
+
+struct BoxKill {
+  static const bool KILLS = true;
+  static const bool LIVE_INDEX = false;
+  static const unsigned INTERVAL = 5000000; //killing time
+  static void default_box(unsigned n, unsigned& first, unsigned& last) {
+    first = n / 4;
+    last = 3 * n / 4;
+  }
+};
+
+struct RandomKill {
+  static const bool KILLS = true;
+  static const bool LIVE_INDEX = true;
+  static const unsigned INTERVAL = 5000000; //killing time
+  static constexpr double FRACTION = 0.90;
+};
+
+struct Local {
+  static const bool LOCAL = true;
+  static const bool CONTRIBUTIONS = false;
+};
+
+struct WellMixed {
+  static const bool LOCAL = false;
+  static const bool CONTRIBUTIONS = true;
+  enum MeanK {GRID_SAMPLE, EXACT, LIVE_SAMPLE};
+  static const unsigned N_SAMPLE = 50; //Sites or live cells drawn for the mean k
+};
+
+struct OneSystem {
+  static const bool LINEAGE = true;
+  static const unsigned OUTPUT_INTERVAL = 10000;
+  static const unsigned long RESCAN_INTERVAL = 1000000;
+  static const unsigned RUNTIME = 0;
+  template <class C,class RNG> static void seed(C&& cell, RNG& rng) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    cell.set_state((uniform(rng) < 0.5) ? 1 : 0);
+    if (cell.get_state() == 1) {
+      // Two different types of bacteria are randomly generated
+      cell.set_state((uniform(rng) < 0.5) ? 1 : 2);
+    }
+    cell.set_ances(cell.get_state());
+  }
+  template <class S> static bool extinct(const S& stats) {
+    return stats.count(1) + stats.count(2) == 0;
+  }
+};
+
+struct TwoSystems {
+  static const bool LINEAGE = false;
+  static const unsigned OUTPUT_INTERVAL = 100;
+  static const unsigned long RESCAN_INTERVAL = 10000;
+  static const unsigned RUNTIME = 20000000;
+  template <class C,class RNG> static void seed(C&& cell, RNG& rng) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    cell.set_state((uniform(rng) < 0.5) ? 3 : 0);
+  }
+  //If DOL or system p goes extinct in the simulation, the simulation will stop immediately
+  template <class S> static bool extinct(const S& stats) {
+    return stats.count(1) + stats.count(2) == 0 || stats.count(3) + stats.count(4) == 0;
+  }
+};
+
+#endif
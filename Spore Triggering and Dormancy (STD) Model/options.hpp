@@ -0,0 +1,128 @@
+/*
+  Options collects the optional command line arguments written as
+  --key=value (or --key, which means --key=1). They are removed from
+  argv, so the positional arguments keep their positions wherever the
+  options are written.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  argc, argv: as given to main(). Both are modified.
+
+  ------------------------------------------------------------
+  Methods:
+
+  get(key,default_value), get_double(key,default_value),
+  get_unsigned(key,default_value):
+
+  The value of the option, or default_value when it was not given. A
+  value that is not a number is an error.
+
+  reject_unknown():
+
+  Every option that has not been asked for with get*() is reported as
+  an error. Call it once all the options have been read.
+
+  An error prints a message and terminates the program.
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+
+#ifndef OPTIONS
+#define OPTIONS
+
+class Options {
+
+private:
+  std::map<std::string,std::string> values;
+  mutable std::set<std::string> used;
+
+  inline const std::string* find(const std::string& key) const;
+
+public:
+  inline Options(int& argc,char** argv);
+
+  inline std::string get(const std::string& key,const std::string& default_value) const;
+  inline double get_double(const std::string& key,const double default_value) const;
+  inline unsigned long get_unsigned(const std::string& key,const unsigned long default_value) const;
+  inline void reject_unknown() const;
+};
+
+Options::Options(int& argc,char** argv)
+{
+  int n_positional = 1;
+  for(int i = 1; i < argc; ++i){
+    const std::string arg = argv[i];
+    if(arg.compare(0,2,"--") != 0 || arg.size() == 2){
+      argv[n_positional++] = argv[i];
+      continue;
+    }
+    const std::string::size_type eq = arg.find('=');
+    if(eq == std::string::npos)
+      values[arg.substr(2)] = "1";
+    else
+      values[arg.substr(2,eq-2)] = arg.substr(eq+1);
+  }
+  argc = n_positional;
+  argv[argc] = nullptr;
+}
+
+const std::string* Options::find(const std::string& key) const
+{
+  used.insert(key);
+  const std::map<std::string,std::string>::const_iterator it = values.find(key);
+  return (it == values.end()) ? nullptr : &it->second;
+}
+
+std::string Options::get(const std::string& key,const std::string& default_value) const
+{
+  const std::string* value = find(key);
+  return value ? *value : default_value;
+}
+
+double Options::get_double(const std::string& key,const double default_value) const
+{
+  const std::string* value = find(key);
+  if(!value)
+    return default_value;
+  char* end;
+  const double result = std::strtod(value->c_str(),&end);
+  if(value->empty() || *end != '\0'){
+    std::cerr << "Options::get_double() Error: --" << key << "=" << *value << " is not a number." << std::endl;
+    exit(-1);
+  }
+  return result;
+}
+
+unsigned long Options::get_unsigned(const std::string& key,const unsigned long default_value) const
+{
+  const std::string* value = find(key);
+  if(!value)
+    return default_value;
+  char* end;
+  const unsigned long result = std::strtoul(value->c_str(),&end,10);
+  if(value->empty() || *end != '\0' || (*value)[0] == '-'){
+    std::cerr << "Options::get_unsigned() Error: --" << key << "=" << *value << " is not a non-negative integer." << std::endl;
+    exit(-1);
+  }
+  return result;
+}
+
+void Options::reject_unknown() const
+{
+  bool unknown = false;
+  for(std::map<std::string,std::string>::const_iterator it = values.begin(); it != values.end(); ++it){
+    if(used.count(it->first) == 0){
+      std::cerr << "Options::reject_unknown() Error: unknown option --" << it->first << std::endl;
+      unknown = true;
+    }
+  }
+  if(unknown)
+    exit(-1);
+}
+
+#endif
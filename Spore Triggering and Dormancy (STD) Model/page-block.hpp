@@ -0,0 +1,267 @@
+/*
+  PageBlock is a block of memory mapped directly from the system, on
+  which CA2D stores its cells. Random updates of a large grid touch a
+  different page at almost every access; on 2 MB huge pages one entry
+  of the TLB covers 512 times more cells than on 4 kB pages. On a
+  machine with several NUMA nodes, the block can also be interleaved
+  over the nodes instead of landing on the node of the thread that
+  first touches it.
+
+  PagePolicy is the choice made for a block:
+
+  pages: SMALL_PAGES (the 4 kB pages of the system), TRANSPARENT_PAGES
+  (transparent huge pages, asked for with madvise()) or EXPLICIT_PAGES
+  (huge pages reserved beforehand in /proc/sys/vm/nr_hugepages, mapped
+  with MAP_HUGETLB). Explicit pages fall back to transparent ones when
+  too few are reserved.
+
+  placement: FIRST_TOUCH (every page goes to the node of the thread
+  that first writes it, the default of the system) or INTERLEAVE (the
+  pages are dealt round-robin to the nodes the process may use).
+
+  ------------------------------------------------------------
+  Constructer:
+
+  size: the size of the block in bytes.
+
+  policy: the pages and the placement of the block.
+
+  The block is filled with zeros and left untouched, so that with
+  FIRST_TOUCH its pages go to the node of its first user.
+
+  ------------------------------------------------------------
+  Methods:
+
+  data(): the start of the block, aligned on 2 MB unless it is on
+  small pages.
+
+  describe(): a line telling the size of the block, the pages it got,
+  how much of it the kernel backs with huge pages right now (from
+  /proc/self/smaps, so it should be called once the block is filled)
+  and its placement.
+
+  parse_pages(name,pages), parse_placement(name,placement): static, the
+  policy of a command line name ("small", "transparent", "explicit";
+  "first-touch", "interleave"), false if the name is unknown.
+*/
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#ifndef PAGEBLOCK
+#define PAGEBLOCK
+
+struct PagePolicy {
+  enum Pages {SMALL_PAGES, TRANSPARENT_PAGES, EXPLICIT_PAGES};
+  enum Placement {FIRST_TOUCH, INTERLEAVE};
+
+  Pages pages = SMALL_PAGES;
+  Placement placement = FIRST_TOUCH;
+};
+
+class PageBlock {
+
+private:
+  static const std::size_t HUGE_PAGE = 2 << 20;
+
+  PagePolicy policy;
+  std::size_t size;
+  void* mapping;
+  std::size_t mapping_size;
+  bool fell_back; // Explicit pages asked for, transparent ones given
+  int bind_error; // errno of mbind(), 0 if it succeeded or was not called
+
+  PageBlock(const PageBlock&);
+  void operator=(const PageBlock&);
+
+  inline void map_transparent();
+  inline void interleave();
+  inline static std::string online_nodes();
+  inline std::size_t huge_bytes() const;
+
+public:
+  inline PageBlock(const std::size_t a_size,const PagePolicy& a_policy);
+  inline ~PageBlock();
+  void* data() const {return mapping;}
+  inline std::string describe() const;
+
+  inline static bool parse_pages(const std::string& name,PagePolicy::Pages& pages);
+  inline static bool parse_placement(const std::string& name,PagePolicy::Placement& placement);
+};
+
+PageBlock::PageBlock(const std::size_t a_size,const PagePolicy& a_policy)
+  : policy(a_policy),
+    size(a_size),
+    mapping(MAP_FAILED),
+    mapping_size(0),
+    fell_back(false),
+    bind_error(0)
+{
+  if(policy.pages == PagePolicy::SMALL_PAGES){
+    mapping_size = size;
+    mapping = mmap(nullptr,mapping_size,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+  }else{
+    mapping_size = (size + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+    if(policy.pages == PagePolicy::EXPLICIT_PAGES){
+      mapping = mmap(nullptr,mapping_size,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,-1,0);
+      fell_back = (mapping == MAP_FAILED);
+    }
+    if(mapping == MAP_FAILED)
+      map_transparent();
+  }
+  if(mapping == MAP_FAILED){
+    std::cerr << "PageBlock::PageBlock() Memory exausted" << std::endl;
+    exit(-1);
+  }
+  if(policy.placement == PagePolicy::INTERLEAVE)
+    interleave();
+}
+
+PageBlock::~PageBlock()
+{
+  if(mapping != MAP_FAILED)
+    munmap(mapping,mapping_size);
+}
+
+/* Map one huge page more than needed, and unmap the parts before and
+   after the first 2 MB boundary, so that the kernel can back the whole
+   block with huge pages. */
+void PageBlock::map_transparent()
+{
+  void* raw = mmap(nullptr,mapping_size + HUGE_PAGE,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+  if(raw == MAP_FAILED)
+    return;
+  const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(raw);
+  const std::uintptr_t aligned = (start + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+  if(aligned > start)
+    munmap(raw,aligned - start);
+  if(start + HUGE_PAGE > aligned)
+    munmap(reinterpret_cast<void*>(aligned + mapping_size),start + HUGE_PAGE - aligned);
+  mapping = reinterpret_cast<void*>(aligned);
+  madvise(mapping,mapping_size,MADV_HUGEPAGE);
+}
+
+/* Interleave the block over the online nodes, read from a list such
+   as "0-1,3". The kernel leaves out the nodes the process may not use.
+   mbind() is called through syscall() so that no library is needed. */
+void PageBlock::interleave()
+{
+  const unsigned long BITS = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask;
+  unsigned long max_node = 0;
+  std::stringstream list(online_nodes());
+  std::string range;
+  while(std::getline(list,range,',')){
+    unsigned long first = 0, last = 0;
+    char dash = '-';
+    std::stringstream ss(range);
+    if(!(ss >> first))
+      continue;
+    if(!(ss >> dash >> last))
+      last = first;
+    for(unsigned long node = first; node <= last; ++node){
+      if(node / BITS >= mask.size())
+        mask.resize(node / BITS + 1,0);
+      mask[node / BITS] |= 1UL << (node % BITS);
+      max_node = std::max(max_node,node);
+    }
+  }
+  // maxnode counts one more than the highest node, as the kernel drops the last bit
+  if(mask.empty() || syscall(SYS_mbind,mapping,mapping_size,MPOL_INTERLEAVE,mask.data(),max_node + 2,0) != 0)
+    bind_error = mask.empty() ? EINVAL : errno;
+}
+
+// The online nodes as listed by the kernel, e.g. "0-1"
+std::string PageBlock::online_nodes()
+{
+  std::ifstream file("/sys/devices/system/node/online");
+  std::string nodes;
+  if(!(file >> nodes))
+    nodes = "0";
+  return nodes;
+}
+
+/* Bytes of the block on huge pages, as counted in the smaps entry of
+   the mapping. The kernel may merge the block with a neighboring
+   mapping of the same kind, so the count is bounded by the size of the
+   block. */
+std::size_t PageBlock::huge_bytes() const
+{
+  if(policy.pages == PagePolicy::EXPLICIT_PAGES && !fell_back)
+    return size;
+  std::ifstream smaps("/proc/self/smaps");
+  const std::uintptr_t start = reinterpret_cast<std::uintptr_t>(mapping);
+  std::string line;
+  bool inside = false;
+  while(std::getline(smaps,line)){
+    std::uintptr_t first, last;
+    char dash;
+    std::stringstream ss(line);
+    if(ss >> std::hex >> first >> dash >> last && dash == '-'){
+      inside = (first <= start && start < last);
+    }else if(inside && line.compare(0,14,"AnonHugePages:") == 0){
+      std::size_t kb = 0;
+      std::stringstream(line.substr(14)) >> kb;
+      return std::min<std::size_t>(kb * 1024,size);
+    }
+  }
+  return 0;
+}
+
+std::string PageBlock::describe() const
+{
+  std::stringstream ss;
+  ss.precision(1);
+  ss << std::fixed << size / 1048576.0 << " MB on ";
+  switch(policy.pages){
+  case PagePolicy::SMALL_PAGES: ss << "small pages"; break;
+  case PagePolicy::TRANSPARENT_PAGES: ss << "transparent huge pages"; break;
+  case PagePolicy::EXPLICIT_PAGES: ss << (fell_back ? "transparent huge pages (no explicit huge page left)" : "explicit huge pages"); break;
+  }
+  ss << ", " << huge_bytes() / 1048576.0 << " MB backed by huge pages, ";
+  if(policy.placement == PagePolicy::FIRST_TOUCH)
+    ss << "first-touch placement";
+  else if(bind_error == 0)
+    ss << "interleaved over nodes " << online_nodes();
+  else
+    ss << "first-touch placement (interleaving failed: " << std::strerror(bind_error) << ")";
+  return ss.str();
+}
+
+bool PageBlock::parse_pages(const std::string& name,PagePolicy::Pages& pages)
+{
+  if(name == "small")
+    pages = PagePolicy::SMALL_PAGES;
+  else if(name == "transparent")
+    pages = PagePolicy::TRANSPARENT_PAGES;
+  else if(name == "explicit")
+    pages = PagePolicy::EXPLICIT_PAGES;
+  else
+    return false;
+  return true;
+}
+
+bool PageBlock::parse_placement(const std::string& name,PagePolicy::Placement& placement)
+{
+  if(name == "first-touch")
+    placement = PagePolicy::FIRST_TOUCH;
+  else if(name == "interleave")
+    placement = PagePolicy::INTERLEAVE;
+  else
+    return false;
+  return true;
+}
+
+#endif
@@ -0,0 +1,96 @@
+/*
+  PropensityTree holds one non-negative rate per cell and selects a
+  cell with probability proportional to its rate in O(log n). It is
+  a complete binary tree stored in an array: the leaves hold the
+  rates and every inner node holds the sum of its two children.
+
+  When a rate changes, the sums on the path to the root are
+  recomputed from the children instead of being adjusted by the
+  difference, so rounding errors do not accumulate however many
+  updates are made.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  n: the number of rates. They are all 0 initially.
+
+  ------------------------------------------------------------
+  Methods:
+
+  set(i,rate), get(i): write and read the i-th rate.
+
+  total(): the sum of all rates.
+
+  find(u): for 0 <= u < total(), the index i such that the sum of the
+  rates before i is <= u and the sum up to and including i is > u.
+  The returned rate is always positive.
+*/
+
+#include <iostream>
+#include <vector>
+
+#ifndef PROPENSITY_TREE
+#define PROPENSITY_TREE
+
+class PropensityTree {
+
+private:
+  unsigned n_leaf; // A power of two, at least n
+  std::vector<double> sum; // Node 1 is the root, the leaves are [n_leaf,2*n_leaf)
+
+public:
+  inline explicit PropensityTree(const unsigned n);
+
+  inline void set(const unsigned i,const double rate);
+  inline double get(const unsigned i) const;
+  inline double total() const;
+  inline unsigned find(double u) const;
+};
+
+PropensityTree::PropensityTree(const unsigned n)
+  : n_leaf(1)
+{
+  if(n==0){
+    std::cerr << "PropensityTree() Error: n=0 is not allowed." << std::endl;
+  }
+  while(n_leaf < n)
+    n_leaf *= 2;
+  sum.assign(2*n_leaf,0.0);
+}
+
+void PropensityTree::set(const unsigned i,const double rate)
+{
+  unsigned node = n_leaf + i;
+  sum[node] = rate;
+  for(node /= 2; node >= 1; node /= 2)
+    sum[node] = sum[2*node] + sum[2*node+1];
+}
+
+double PropensityTree::get(const unsigned i) const
+{
+  return sum[n_leaf + i];
+}
+
+double PropensityTree::total() const
+{
+  return sum[1];
+}
+
+/* A branch with a zero sum is never taken, even when rounding makes u
+   reach the end of the other branch. */
+unsigned PropensityTree::find(double u) const
+{
+  unsigned node = 1;
+  while(node < n_leaf){
+    const double left = sum[2*node];
+    if((u < left && left > 0.0) || sum[2*node+1] <= 0.0){
+      node = 2*node;
+    }else{
+      u -= left;
+      node = 2*node+1;
+    }
+  }
+  return node - n_leaf;
+}
+
+#endif
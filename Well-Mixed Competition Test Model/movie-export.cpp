@@ -0,0 +1,103 @@
+/* movie-export converts a movie written by CashDisplay::open_movie()
+   into the png files that open_png() would have written, or into a y4m
+   video that ffmpeg and most players read.
+
+   ./movie-export movie.mov png DIRECTORY [first] [last]
+   ./movie-export movie.mov y4m FILE [first] [last] [fps]
+
+   The frames first to last (from 0, all by default) are exported. The
+   png files are named after the frame numbers, so exporting a part of
+   a movie gives the same files as the whole one. FILE may be - to
+   write the video to the standard output. */
+
+/* Library */
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <png.h> // PNG_ALL_FILTERS
+
+/* My library */
+#include "cash.h"
+#include "movie-recorder.hpp"
+
+// Converts a frame into the planes Y, Cb and Cr (BT.601, limited range)
+void frameToYuv(const unsigned char* frame, const unsigned char* palette, std::size_t size, std::vector<unsigned char>& yuv) {
+    unsigned char colors[256][3];
+    for (int c = 0; c < 256; ++c) {
+        const double r = palette[3 * c], g = palette[3 * c + 1], b = palette[3 * c + 2];
+        colors[c][0] = static_cast<unsigned char>(16.0 + (65.481 * r + 128.553 * g + 24.966 * b) / 255.0 + 0.5);
+        colors[c][1] = static_cast<unsigned char>(128.0 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255.0 + 0.5);
+        colors[c][2] = static_cast<unsigned char>(128.0 + (112.0 * r - 93.786 * g - 18.214 * b) / 255.0 + 0.5);
+    }
+    yuv.resize(3 * size);
+    for (std::size_t i = 0; i < size; ++i) {
+        yuv[i] = colors[frame[i]][0];
+        yuv[size + i] = colors[frame[i]][1];
+        yuv[2 * size + i] = colors[frame[i]][2];
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4 || argc > 7 || (std::string(argv[2]) != "png" && std::string(argv[2]) != "y4m")) {
+        std::cerr << "Usage: " << argv[0] << " MovieFile png Directory [first] [last]" << std::endl;
+        std::cerr << "       " << argv[0] << " MovieFile y4m File|- [first] [last] [fps]" << std::endl;
+        exit(-1);
+    }
+    const std::string format = argv[2];
+    const std::string output = argv[3];
+
+    MovieReader movie(argv[1]);
+    if (movie.get_n_frames() == 0) {
+        std::cerr << "main(): Error, " << argv[1] << " has no frame" << std::endl;
+        exit(-1);
+    }
+    const unsigned long first = (argc > 4) ? std::strtoul(argv[4], nullptr, 10) : 0;
+    const unsigned long last = (argc > 5) ? std::strtoul(argv[5], nullptr, 10) : movie.get_n_frames() - 1;
+    const unsigned long fps = (argc > 6) ? std::strtoul(argv[6], nullptr, 10) : 25;
+    if (first > last || last >= movie.get_n_frames() || fps == 0) {
+        std::cerr << "main(): Error, frames " << first << " to " << last << " at " << fps << " fps, the movie has " << movie.get_n_frames() << " frames" << std::endl;
+        exit(-1);
+    }
+    const int nrow = movie.get_n_row();
+    const int ncol = movie.get_n_col();
+
+    if (format == "png") {
+        std::vector<char> dirname(output.begin(), output.end());
+        dirname.push_back('\0');
+        OpenPNG(dirname.data(), nrow, ncol);
+        ResetNFrames(first);
+        for (unsigned long n = first; n <= last; ++n) {
+            const unsigned char* frame = movie.frame(n);
+            const unsigned char* palette = movie.palette();
+            for (int c = 0; c < 256; ++c)
+                ColorRGB(c, palette[3 * c], palette[3 * c + 1], palette[3 * c + 2]);
+            char name[512];
+            NextPNGName(name);
+            if (WritePNG(name, frame, nrow, ncol, 0, 6, PNG_ALL_FILTERS) != 0)
+                exit(-1);
+        }
+        ClosePNG();
+    } else {
+        FILE* fp = (output == "-") ? stdout : std::fopen(output.c_str(), "wb");
+        if (fp == nullptr) {
+            std::cerr << "main(): Error, cannot open " << output << std::endl;
+            exit(-1);
+        }
+        std::fprintf(fp, "YUV4MPEG2 W%d H%d F%lu:1 Ip A1:1 C444\n", ncol, nrow, fps);
+        std::vector<unsigned char> yuv;
+        for (unsigned long n = first; n <= last; ++n) {
+            const unsigned char* frame = movie.frame(n);
+            frameToYuv(frame, movie.palette(), static_cast<std::size_t>(nrow) * ncol, yuv);
+            std::fputs("FRAME\n", fp);
+            if (std::fwrite(yuv.data(), 1, yuv.size(), fp) != yuv.size()) {
+                std::cerr << "main(): Error, cannot write " << output << std::endl;
+                exit(-1);
+            }
+        }
+        if (fp != stdout)
+            std::fclose(fp);
+    }
+    return (0);
+}
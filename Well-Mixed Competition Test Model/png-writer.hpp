@@ -0,0 +1,198 @@
+/*
+  PngWriter encodes the frames of a movie into png files in background
+  threads, so that the simulation goes on while the frames are
+  compressed and written.
+
+  A frame is copied into one of queue_size buffers when it is
+  submitted, so the caller can draw the next frame at once. When all
+  the buffers are waiting to be written, submit() blocks until a thread
+  is done with one of them: a simulation that makes frames faster than
+  they can be written is slowed down instead of using more and more
+  memory.
+
+  ------------------------------------------------------------
+  Constructer:
+
+  n_threads: the number of encoding threads, at least 1.
+
+  queue_size: the number of frame buffers, at least 1.
+
+  level: the zlib compression level, from 0 (fastest) to 9 (smallest).
+
+  filter: the row filters tried by the encoder, one of none, sub, up,
+  avg, paeth or all. libpng uses all of them by default.
+
+  An invalid argument prints a message and terminates the program.
+
+  ------------------------------------------------------------
+  Methods:
+
+  submit(name,data,nrow,ncol,c):
+
+  Writes the frame data, nrow x ncol color indices shifted by c as in
+  BlockPNG(), to the file name.
+
+  wait():
+
+  Returns once every submitted frame has been written. The destructor
+  waits too.
+*/
+
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <png.h>
+
+#ifndef PNG_WRITER
+#define PNG_WRITER
+
+/* WritePNG() of png.c, also declared in cash.h, which cannot be
+   included twice */
+extern "C" int WritePNG(const char*,const unsigned char*,int,int,int,int,int);
+
+class PngWriter {
+
+private:
+  struct Frame {
+    std::string name;
+    std::vector<unsigned char> data;
+    int nrow;
+    int ncol;
+    int c;
+  };
+
+  int level;
+  int filters;
+
+  std::vector<Frame> frames;
+  std::deque<unsigned> free_frames; // Buffers ready for a new frame
+  std::deque<unsigned> queued_frames; // Buffers waiting to be written, oldest first
+  bool stopping;
+
+  std::mutex mutex;
+  std::condition_variable frame_queued;
+  std::condition_variable frame_freed;
+  std::vector<std::thread> threads;
+
+  inline static int filter_flags(const std::string& filter);
+  inline void work();
+
+  PngWriter(const PngWriter& rhs);
+  void operator=(const PngWriter& rhs);
+
+public:
+  inline PngWriter(const unsigned n_threads,const unsigned queue_size,const int a_level,const std::string& filter);
+  inline ~PngWriter();
+
+  inline void submit(const std::string& name,const unsigned char* data,const int nrow,const int ncol,const int c);
+  inline void wait();
+};
+
+PngWriter::PngWriter(const unsigned n_threads,const unsigned queue_size,const int a_level,const std::string& filter)
+  : level(a_level),
+    filters(filter_flags(filter)),
+    frames(queue_size),
+    stopping(false)
+{
+  if(n_threads == 0 || queue_size == 0){
+    std::cerr << "PngWriter() Error: n_threads=" << n_threads << " queue_size=" << queue_size << ", both must be positive." << std::endl;
+    exit(-1);
+  }
+  if(level < 0 || level > 9){
+    std::cerr << "PngWriter() Error: the compression level " << level << " is not between 0 and 9." << std::endl;
+    exit(-1);
+  }
+  if(filters < 0){
+    std::cerr << "PngWriter() Error: unknown filter " << filter << " (expected none, sub, up, avg, paeth or all)." << std::endl;
+    exit(-1);
+  }
+  for(unsigned ind = 0; ind < queue_size; ++ind)
+    free_frames.push_back(ind);
+  for(unsigned i = 0; i < n_threads; ++i)
+    threads.push_back(std::thread(&PngWriter::work,this));
+}
+
+PngWriter::~PngWriter()
+{
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  frame_queued.notify_all();
+  for(std::thread& thread : threads)
+    thread.join();
+}
+
+// The PNG_FILTER_* flags of a filter name, -1 for an unknown name
+int PngWriter::filter_flags(const std::string& filter)
+{
+  if(filter == "none") return PNG_FILTER_NONE;
+  if(filter == "sub") return PNG_FILTER_SUB;
+  if(filter == "up") return PNG_FILTER_UP;
+  if(filter == "avg") return PNG_FILTER_AVG;
+  if(filter == "paeth") return PNG_FILTER_PAETH;
+  if(filter == "all") return PNG_ALL_FILTERS;
+  return -1;
+}
+
+// Loop of an encoding thread
+void PngWriter::work()
+{
+  for(;;){
+    unsigned ind;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      frame_queued.wait(lock,[this]{return stopping || !queued_frames.empty();});
+      if(queued_frames.empty())
+        return;
+      ind = queued_frames.front();
+      queued_frames.pop_front();
+    }
+    const Frame& frame = frames[ind];
+    WritePNG(frame.name.c_str(),frame.data.data(),frame.nrow,frame.ncol,frame.c,level,filters);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      free_frames.push_back(ind);
+    }
+    frame_freed.notify_all();
+  }
+}
+
+void PngWriter::submit(const std::string& name,const unsigned char* data,const int nrow,const int ncol,const int c)
+{
+  unsigned ind;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    frame_freed.wait(lock,[this]{return !free_frames.empty();});
+    ind = free_frames.front();
+    free_frames.pop_front();
+  }
+
+  // The buffer belongs to the caller until it is queued
+  Frame& frame = frames[ind];
+  frame.name = name;
+  frame.data.assign(data,data + nrow*ncol);
+  frame.nrow = nrow;
+  frame.ncol = ncol;
+  frame.c = c;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queued_frames.push_back(ind);
+  }
+  frame_queued.notify_one();
+}
+
+void PngWriter::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  frame_freed.wait(lock,[this]{return free_frames.size() == frames.size();});
+}
+
+#endif
@@ -0,0 +1,1409 @@
+/* Library */
+#include <csignal> // for signal handling
+#include <sstream> // for std::stringstream
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm> // std::shuffle
+#include <type_traits> // std::is_same
+#include <fstream>
+#include <sys/stat.h> // stat()
+#include <unistd.h> // truncate()
+#ifdef _OPENMP
+#include <omp.h> // omp_set_num_threads()
+#endif
+
+#include "simulation.hpp"
+#include "model.hpp"
+
+// The options of read_run_options(), with their defaults
+const std::string RUN_OPTIONS_USAGE =
+    "[--engine=sweep|active|ssa|parallel] [--threads=N] [--tile=16] "
+    "[--rescan=" + std::to_string(Model::Systems::RESCAN_INTERVAL) + "] [--prefetch=0] "
+    "[--png-threads=1] [--png-queue=2] [--png-level=6] [--png-filter=none|sub|up|avg|paeth|all] "
+    "[--movie=png|mov|none] [--movie-key=100] "
+    "[--checkpoint-every=10000] [--checkpoint-level=0] [--max-wall-seconds=0] "
+    "[--series=csv|bin] [--rows=100] [--cols=100] [--kill-box=Row1,Col1,Row2,Col2] "
+    "[--radius=2] [--mean-k=grid-sample|exact|live-sample] "
+    "[--pages=small|transparent|explicit] [--numa=first-touch|interleave]";
+
+// The run time and the rescan interval are those of the model built in this folder
+RunConfig::RunConfig()
+    : runtime(Model::Systems::RUNTIME),
+      rescan_interval(Model::Systems::RESCAN_INTERVAL) {
+}
+
+// Set by on_signal(), checked at the start of every time step
+std::atomic<unsigned> checkpoint_requests(0);
+std::atomic<bool> stop_requested(false);
+
+// SIGUSR1 asks for a checkpoint, SIGTERM for a checkpoint and a clean exit
+void on_signal(int signum) {
+    if (signum == SIGTERM) {
+        stop_requested = true;
+    }
+    ++checkpoint_requests;
+}
+
+// Read the options of a run into config, whose values are the defaults, and check them
+bool read_run_options(const Options& options, RunConfig& config) {
+    config.engine = options.get("engine", config.engine);
+    config.n_threads = options.get_unsigned("threads", config.n_threads);
+    config.tile_side = options.get_unsigned("tile", config.tile_side);
+    config.rescan_interval = options.get_unsigned("rescan", config.rescan_interval);
+    config.prefetch = options.get_unsigned("prefetch", config.prefetch);
+    config.png_threads = options.get_unsigned("png-threads", config.png_threads);
+    config.png_queue = options.get_unsigned("png-queue", config.png_queue);
+    config.png_level = options.get_unsigned("png-level", config.png_level);
+    config.png_filter = options.get("png-filter", config.png_filter);
+    config.movie = options.get("movie", config.movie);
+    config.movie_key = options.get_unsigned("movie-key", config.movie_key);
+    config.checkpoint_every = options.get_unsigned("checkpoint-every", config.checkpoint_every);
+    config.checkpoint_level = options.get_unsigned("checkpoint-level", config.checkpoint_level);
+    config.max_wall_seconds = options.get_unsigned("max-wall-seconds", config.max_wall_seconds);
+    config.series = options.get("series", config.series);
+    config.n_row = options.get_unsigned("rows", config.n_row);
+    config.n_col = options.get_unsigned("cols", config.n_col);
+    std::string kill_box = options.get("kill-box", "");
+    config.radius = options.get_unsigned("radius", config.radius);
+    config.mean_k = options.get("mean-k", config.mean_k);
+    std::string pages = options.get("pages", "");
+    std::string numa = options.get("numa", "");
+    options.reject_unknown();
+    if (config.engine != "sweep" && config.engine != "active" && config.engine != "ssa" && config.engine != "parallel") {
+        std::cerr << "Unknown engine: " << config.engine << " (expected sweep, active, ssa or parallel)" << std::endl;
+        return false;
+    }
+    // The offspring of a well-mixed population reach any cell, which only the sweep follows
+    if (!Model::Neighborhood::LOCAL && config.engine != "sweep") {
+        std::cerr << "This model only runs on the sweep engine (its offspring are born anywhere on the grid)" << std::endl;
+        return false;
+    }
+    if (config.mean_k != "grid-sample" && config.mean_k != "exact" && config.mean_k != "live-sample") {
+        std::cerr << "Unknown mean k: " << config.mean_k << " (expected grid-sample, exact or live-sample)" << std::endl;
+        return false;
+    }
+    if (Model::Neighborhood::LOCAL && config.mean_k != "grid-sample") {
+        std::cerr << "This model has no mean k (--mean-k is for the Well-Mixed Competition model)" << std::endl;
+        return false;
+    }
+    if (config.movie != "png" && config.movie != "mov" && config.movie != "none") {
+        std::cerr << "Unknown movie format: " << config.movie << " (expected png, mov or none)" << std::endl;
+        return false;
+    }
+    if (!pages.empty() && !PageBlock::parse_pages(pages, config.grid_pages.pages)) {
+        std::cerr << "Unknown pages: " << pages << " (expected small, transparent or explicit)" << std::endl;
+        return false;
+    }
+    if (!numa.empty() && !PageBlock::parse_placement(numa, config.grid_pages.placement)) {
+        std::cerr << "Unknown NUMA placement: " << numa << " (expected first-touch or interleave)" << std::endl;
+        return false;
+    }
+    if (config.series != "csv" && config.series != "bin") {
+        std::cerr << "Unknown series format: " << config.series << " (expected csv or bin)" << std::endl;
+        return false;
+    }
+    if (config.checkpoint_level > 9) {
+        std::cerr << "The checkpoint level must be between 0 and 9" << std::endl;
+        return false;
+    }
+    config.wall_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(config.max_wall_seconds);
+    if (config.rescan_interval == 0) {
+        std::cerr << "The rescan interval must be positive" << std::endl;
+        return false;
+    }
+    if (config.n_row < MIN_SIDE || config.n_row > MAX_SIDE || config.n_col < MIN_SIDE || config.n_col > MAX_SIDE) {
+        std::cerr << "The grid must have between " << MIN_SIDE << " and " << MAX_SIDE << " rows and columns" << std::endl;
+        return false;
+    }
+    // The neighborhood of the public goods must fit in the torus
+    if (config.radius < 1 || 2 * config.radius + 1 > std::min(config.n_row, config.n_col)) {
+        std::cerr << "The public goods radius must be between 1 and " << (std::min(config.n_row, config.n_col) - 1) / 2 << " on this grid" << std::endl;
+        return false;
+    }
+    if (!kill_box.empty()) {
+        if (!std::is_same<Model::Perturbation, BoxKill>::value) {
+            std::cerr << "This model kills no box (--kill-box is for the Periodic Local Extinction model)" << std::endl;
+            return false;
+        }
+        // Row1,Col1,Row2,Col2: the corners of the box, inside the grid
+        std::stringstream ss(kill_box);
+        config.kill_box.assign(4, 0);
+        char comma[3];
+        std::string rest;
+        if (!(ss >> config.kill_box[0] >> comma[0] >> config.kill_box[1] >> comma[1] >> config.kill_box[2] >> comma[2] >> config.kill_box[3])
+            || comma[0] != ',' || comma[1] != ',' || comma[2] != ',' || (ss >> rest)
+            || config.kill_box[0] < 1 || config.kill_box[0] > config.kill_box[2] || config.kill_box[2] > config.n_row
+            || config.kill_box[1] < 1 || config.kill_box[1] > config.kill_box[3] || config.kill_box[3] > config.n_col) {
+            std::cerr << "Wrong kill box: " << kill_box << " (expected Row1,Col1,Row2,Col2 with 1 <= Row1 <= Row2 <= "
+                      << config.n_row << " and 1 <= Col1 <= Col2 <= " << config.n_col << ")" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// read history file
+void loadCellStates(const std::string& filename, AutomatonGrid& ca_curr) {
+    std::ifstream inFile(filename);
+    if (!inFile) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return;
+    }
+
+    std::string line;
+    while (std::getline(inFile, line)) {
+        std::stringstream ss(line);
+        unsigned row, col, state;
+        double da, ka, db, kb; // Adjusted the order to match the saving order
+
+        if (!(ss >> row >> col >> state >> da >> ka >> db >> kb)) {
+            std::cerr << "Error reading line: " << line << std::endl;
+            inFile.close();
+            return;
+        }
+
+        try {
+            auto&& cell = ca_curr.cell(row, col);
+            cell.set_state(state);
+            cell.set_keep(da, ka, db, kb);  // Adjusted the order to match the saving order
+        } catch (const std::exception& e) {
+            std::cerr << "Error processing cell at (" << row << ", " << col << "): " << e.what() << std::endl;
+            inFile.close();
+            return;
+        }
+    }
+
+    inFile.close();
+}
+
+
+// record history
+void saveCellStates(const std::string& filename, AutomatonGrid& ca_curr, unsigned n_row, unsigned n_col) {
+    std::ofstream outFile(filename);
+    if (!outFile) {
+        std::cerr << "Error opening file: " << filename << std::endl;
+        return;
+    }
+
+    // Iterate over the grid row by row and column by column
+    for (unsigned row = 1; row <= n_row; ++row) {
+        for (unsigned col = 1; col <= n_col; ++col) {
+            auto&& cell = ca_curr.cell(row, col);
+            // Write the cell's parameters to the file
+            outFile << row << " " << col << " " << cell.get_state() << " "
+                    << cell.get_da() << " " << cell.get_ka() << " "
+                    << cell.get_db() << " " << cell.get_kb() << "\n";
+        }
+    }
+
+    outFile.close();
+}
+
+// The command line settings the results of a run depend on
+std::string runSettings(const RunConfig& config) {
+    std::stringstream ss;
+    ss.precision(17);
+    ss << "move=" << config.move << " mutation=" << config.mutation << " death=" << config.death << " seed=" << config.seed
+       << " engine=" << config.engine << " tile=" << config.tile_side << " rescan=" << config.rescan_interval << " series=" << config.series;
+    // The size of the grid is in the header of the checkpoints, the default box follows from it
+    if (!config.kill_box.empty()) {
+        ss << " kill-box=" << config.kill_box[0] << "," << config.kill_box[1] << "," << config.kill_box[2] << "," << config.kill_box[3];
+    }
+    if (config.radius != 2) {
+        ss << " radius=" << config.radius;
+    }
+    if (config.mean_k != "grid-sample") {
+        ss << " mean-k=" << config.mean_k;
+    }
+    return ss.str();
+}
+
+template <class Model> Simulation<Model>::Simulation(const RunConfig& a_config)
+  : config(a_config),
+    settings(runSettings(a_config)),
+    t(1),
+    n_row(a_config.n_row),
+    n_col(a_config.n_col),
+    uniform(0.0, 1.0),
+    ca_curr(nullptr),
+    display_p(nullptr),
+    pg_field(nullptr),
+    active_sites(nullptr),
+    ssa_tree(nullptr),
+    tiles(nullptr),
+    state_stats(nullptr),
+    ancestor_stats(nullptr),
+    dol_k(nullptr),
+    p_k(nullptr),
+    live_cells(nullptr),
+    mean_k_mode(WellMixed::GRID_SAMPLE),
+    movie_interval(Model::MOVIE_INTERVAL),
+    start_time(0),
+    time(0),
+    checkpoints_seen(checkpoint_requests),
+    lastKillTime(0)
+{
+    //move chance and mortality, shared by every cell
+    params.Move_chance = config.move;
+    params.death = config.death;
+
+    // Set the random seed
+    random.seed(config.seed);
+
+    // How a well-mixed cell perceives the mean k
+    if (config.mean_k == "exact") {
+        mean_k_mode = WellMixed::EXACT;
+    } else if (config.mean_k == "live-sample") {
+        mean_k_mode = WellMixed::LIVE_SAMPLE;
+    }
+
+    // The box of BoxKill, the middle half of the grid unless given
+    if (config.kill_box.empty()) {
+        BoxKill::default_box(n_row, box[0], box[2]);
+        BoxKill::default_box(n_col, box[1], box[3]);
+    } else {
+        for (unsigned i = 0; i < 4; ++i) {
+            box[i] = config.kill_box[i];
+        }
+    }
+
+    /* Instantiate the n_row x n_col cellular automata. In this demo, we
+       demonstrate synchronously updated CA, so we need two CA objects. */
+    ca_curr = new AutomatonGrid(n_row, n_col, config.grid_pages);
+
+    /* A checkpoint given as the input file resumes the run that wrote it:
+       the grid, the random number generator and the time step are
+       loaded from it. */
+    CheckpointReader* resume = nullptr;
+    if (!config.input_file.empty() && CheckpointReader::is_checkpoint(config.input_file)) {
+        resume = new CheckpointReader(config.input_file);
+        start_time = loadCheckpoint(*resume);
+    }
+    time = start_time;
+
+    if (config.movie != "none") {
+        /* Set parameters needed to display the CA. For this demo, we create
+           only one panel */
+        std::vector<CashPanelInfo> panel_info(1);
+
+        /* Set a display panel size to the size of the grid */
+        panel_info[0].n_row = n_row;
+        panel_info[0].n_col = n_col;
+
+        /* Set the origin coordinate of the display panel */
+        panel_info[0].o_row = 0;
+        panel_info[0].o_col = 0;
+
+        /* Instantiate the display object */
+        try {
+            /* Window size is set to the size of the grid, but can be bigger if more
+               than one panel needs to be drawn. Only one window is allowed to open. */
+            display_p = new CashDisplay(n_row, n_col, panel_info);
+        }
+        catch (const std::bad_alloc&) {
+            std::cerr << "Simulation(): Error, memory exhaustion" << std::endl;
+            exit(-1);
+        }
+
+        // The panel is painted from the grid only when a frame is drawn
+        display_p->set_painter(0, [this](int row, int col) {return cell_color(Systems(), row, col);});
+
+        // A resumed run goes on with the next frame, in a new mov file
+        if (config.movie == "mov")
+            display_p->open_movie(output_path(resume ? "movie-" + std::to_string(start_time) + ".mov" : "movie.mov"), config.movie_key);
+        else
+            display_p->open_png(output_path("movie"), config.png_threads, config.png_queue, config.png_level, config.png_filter);
+        display_p->reset_movie_frame((start_time + movie_interval - 1) / movie_interval);
+    }
+
+    /* Initialize the CA. Note that [0][col], [n_row+1][col], [row][0],
+       [row][n_col+1] are the boundaries, whose states are usually fixed. */
+    // Load initial cell states if input file is provided
+    if (resume) {
+        // The grid was loaded with the checkpoint
+    } else if (!config.input_file.empty()) {
+        loadCellStates(config.input_file, *ca_curr);
+    } else {
+        // Initialize the CA if no input file is provided (see model-policies.hpp)
+        for (unsigned row = 1; row <= n_row; ++row) {
+            for (unsigned col = 1; col <= n_col; ++col) {
+                Systems::seed(ca_curr->cell(row, col), random);
+            }
+        }
+    }
+
+    // The boundaries hold the images of the cells, kept up to date by cell_changed() from now on
+    ca_curr->refresh_halo();
+
+    // Public goods field follows every change of the grid from now on
+    if (Neighborhood::LOCAL) {
+        pg_field = new PublicGoodsField<AutomatonGrid>(n_row, n_col, config.radius);
+        pg_field->rebuild(*ca_curr);
+    }
+    // The k each system provides around every cell, for the contributions
+    if (Neighborhood::CONTRIBUTIONS) {
+        dol_k = new PublicGoodsField<AutomatonGrid, DolSystem>(n_row, n_col, config.radius);
+        dol_k->rebuild(*ca_curr);
+        p_k = new PublicGoodsField<AutomatonGrid, SystemP>(n_row, n_col, config.radius);
+        p_k->rebuild(*ca_curr);
+    }
+    /* The killing of some variants draws its victims from the live
+       cells, and so does the live-sample estimate of the mean k */
+    if (Perturbation::LIVE_INDEX || mean_k_mode == WellMixed::LIVE_SAMPLE) {
+        live_cells = new SiteSet(n_row * n_col);
+        rebuild_live_cells();
+        if (resume && config.engine != "parallel") {
+            restore_live_cells(resume->get_values<unsigned>("live"));
+        }
+    }
+
+    // Counts and trait sums written to the output files
+    state_stats = new PopulationStats<AutomatonGrid, ByState>(n_row, n_col);
+    if (Systems::LINEAGE) {
+        ancestor_stats = new PopulationStats<AutomatonGrid, ByAncestor>(n_row, n_col);
+    }
+    rescan_stats();
+    if (resume) {
+        state_stats->set_totals(resume->get_values<double>("state_sums"));
+        if (ancestor_stats) {
+            ancestor_stats->set_totals(resume->get_values<double>("ances_sums"));
+        }
+    }
+
+    // The active sites are only needed by the active engine
+    if (config.engine == "active") {
+        active_sites = new ActiveSites<AutomatonGrid>(n_row, n_col);
+        active_sites->rebuild(*ca_curr);
+        if (resume) {
+            active_sites->set_order(resume->get_values<unsigned>("active"));
+        }
+    }
+
+    // The exact engine keeps the rate of every cell
+    if (config.engine == "ssa") {
+        ssa_tree = new PropensityTree(n_row * n_col);
+        for (unsigned row = 1; row <= n_row; ++row) {
+            for (unsigned col = 1; col <= n_col; ++col) {
+                ssa_tree->set((row - 1) * n_col + (col - 1), propensity(row, col));
+            }
+        }
+    }
+
+    // The parallel engine updates the tiles of one color at a time
+    if (config.engine == "parallel") {
+        // An update reaches the cells of the public goods neighborhood of a cell one step away
+        tiles = new TileSchedule(n_row, n_col, config.tile_side, config.radius + 1);
+    }
+
+    // Create the output files with their headers, or go on with those of the resumed run
+    if (std::is_same<Systems, OneSystem>::value) {
+        openOutput(cellOutFile, "cell_states", "TimeStep,State1AvgKa,State1AvgDa,State2AvgKb,State2AvgDb,countState1,countState2,totalCount", "fffffuuu", resume, "cells_size");
+    } else if (Neighborhood::CONTRIBUTIONS) {
+        openOutput(cellOutFile, "cell_states", "TimeStep,State1AvgKa,State1AvgDa,State2AvgKb,State2AvgDb,State3AvgKa,State3AvgDa,State4AvgKb,State4AvgDb,countState1,countState2,countState3,countState4,totalCount1,totalCount2,K21,K11,K12,K22", "uffffffffuuuuuuffff", resume, "cells_size");
+    } else {
+        openOutput(cellOutFile, "cell_states", "TimeStep,State1AvgKa,State1AvgDa,State2AvgKb,State2AvgDb,State3AvgKa,State3AvgDa,State4AvgKb,State4AvgDb,countState1,countState2,countState3,countState4,totalCount1,totalCount2", "uffffffffuuuuuu", resume, "cells_size");
+    }
+    if (Systems::LINEAGE) {
+        openOutput(ancestorOutFile, "ancestor_states", "TimeStep,Num1,Num2", "fuu", resume, "ancestors_size");
+    }
+    if (Neighborhood::CONTRIBUTIONS) {
+        openOutput(contributionOutFile, "contribution_states", "TimeStep,Total1Avgcon,Total2Avgcon", "uff", resume, "contrib_size");
+    }
+    delete resume;
+}
+
+template <class Model> Simulation<Model>::~Simulation()
+{
+    cellOutFile.close();
+    ancestorOutFile.close();
+    contributionOutFile.close();
+    delete ca_curr;
+    delete pg_field;
+    delete dol_k;
+    delete p_k;
+    delete active_sites;
+    delete ssa_tree;
+    delete tiles;
+    delete state_stats;
+    delete ancestor_stats;
+    delete live_cells;
+    delete display_p;
+}
+
+// The file name in the output directory of the run
+template <class Model> std::string Simulation<Model>::output_path(const std::string& name) const {
+    return config.out_dir.empty() ? name : config.out_dir + "/" + name;
+}
+
+/* Binary checkpoint (see checkpoint.hpp) of the run at the start of the
+   step time. It holds everything the following steps depend on, so that
+   a run resumed from it writes the same results as the run that wrote
+   it, and the sizes of the output files at that step, which must have
+   been flushed. The ancestor tags are only saved when the model tracks
+   the lineage. */
+template <class Model> void Simulation<Model>::saveCheckpoint(const std::string& filename) {
+    const std::size_t n_cell = static_cast<std::size_t>(n_row) * n_col;
+    std::vector<unsigned char> state(n_cell), ances(n_cell);
+    std::vector<double> traits(4 * n_cell);
+    for (std::size_t ind = 0; ind < n_cell; ++ind) {
+        auto&& cell = ca_curr->cell(ind / n_col + 1, ind % n_col + 1);
+        state[ind] = cell.get_state();
+        ances[ind] = cell.get_ances();
+        traits[4 * ind] = cell.get_da();
+        traits[4 * ind + 1] = cell.get_ka();
+        traits[4 * ind + 2] = cell.get_db();
+        traits[4 * ind + 3] = cell.get_kb();
+    }
+    std::vector<std::uint64_t> rng_state(3);
+    random.get_state(rng_state.data());
+
+    CheckpointWriter checkpoint(Model::name(), n_row, n_col);
+    checkpoint.add_text("settings", settings);
+    checkpoint.add_value("time", static_cast<std::uint64_t>(time));
+    if (Perturbation::KILLS) {
+        checkpoint.add_value("last_kill", static_cast<std::uint64_t>(lastKillTime));
+    }
+    checkpoint.add_values("rng", rng_state);
+    checkpoint.add_values("state", state);
+    if (Systems::LINEAGE) {
+        checkpoint.add_values("ances", ances);
+    }
+    checkpoint.add_values("traits", traits);
+    std::vector<double> totals;
+    state_stats->get_totals(totals);
+    checkpoint.add_values("state_sums", totals);
+    if (ancestor_stats) {
+        ancestor_stats->get_totals(totals);
+        checkpoint.add_values("ances_sums", totals);
+    }
+    if (active_sites) {
+        std::vector<unsigned> order;
+        active_sites->get_order(order);
+        checkpoint.add_values("active", order);
+    }
+    // The parallel engine rebuilds the live-cell index before using it
+    if (live_cells && !tiles) {
+        std::vector<unsigned> live(live_cells->size());
+        for (unsigned i = 0; i < live_cells->size(); ++i) {
+            live[i] = live_cells->at(i);
+        }
+        checkpoint.add_values("live", live);
+    }
+    checkpoint.add_value("cells_size", cellOutFile.size());
+    if (Systems::LINEAGE) {
+        checkpoint.add_value("ancestors_size", ancestorOutFile.size());
+    }
+    if (Neighborhood::CONTRIBUTIONS) {
+        checkpoint.add_value("contrib_size", contributionOutFile.size());
+    }
+    checkpoint.write(filename, config.checkpoint_level);
+}
+
+// Load the grid and the random number generator of a checkpoint, and return its time step
+template <class Model> unsigned Simulation<Model>::loadCheckpoint(const CheckpointReader& checkpoint) {
+    if (checkpoint.get_model() != Model::name() || checkpoint.get_n_row() != n_row || checkpoint.get_n_col() != n_col) {
+        std::cerr << "loadCheckpoint(): Error, the checkpoint is of " << checkpoint.get_model() << " on a "
+                  << checkpoint.get_n_row() << "x" << checkpoint.get_n_col() << " grid" << std::endl;
+        exit(-1);
+    }
+    if (checkpoint.get_text("settings") != settings) {
+        std::cerr << "loadCheckpoint(): Error, the checkpoint was written with the settings" << std::endl
+                  << "  " << checkpoint.get_text("settings") << std::endl
+                  << "and this run has" << std::endl
+                  << "  " << settings << std::endl;
+        exit(-1);
+    }
+    const std::size_t n_cell = static_cast<std::size_t>(n_row) * n_col;
+    std::size_t n_state, n_ances = n_cell, n_traits, n_rng;
+    const unsigned char* state = checkpoint.values<unsigned char>("state", n_state);
+    const unsigned char* ances = Systems::LINEAGE ? checkpoint.values<unsigned char>("ances", n_ances) : nullptr;
+    const double* traits = checkpoint.values<double>("traits", n_traits);
+    const std::uint64_t* rng_state = checkpoint.values<std::uint64_t>("rng", n_rng);
+    if (n_state != n_cell || n_ances != n_cell || n_traits != 4 * n_cell || n_rng != 3) {
+        std::cerr << "loadCheckpoint(): Error, the checkpoint is incomplete" << std::endl;
+        exit(-1);
+    }
+    for (std::size_t ind = 0; ind < n_cell; ++ind) {
+        auto&& cell = ca_curr->cell(ind / n_col + 1, ind % n_col + 1);
+        cell.set_state(state[ind]);
+        if (ances) {
+            cell.set_ances(ances[ind]);
+        }
+        cell.set_keep(traits[4 * ind], traits[4 * ind + 1], traits[4 * ind + 2], traits[4 * ind + 3]);
+    }
+    random.set_state(rng_state);
+    if (Perturbation::KILLS) {
+        lastKillTime = checkpoint.get_value<std::uint64_t>("last_kill");
+    }
+    return checkpoint.get_value<std::uint64_t>("time");
+}
+
+// Put the live-cell index in the order saved in a checkpoint, on which its picks depend
+template <class Model> void Simulation<Model>::restore_live_cells(const std::vector<unsigned>& order) {
+    unsigned n_live = live_cells->size();
+    live_cells->clear();
+    for (unsigned ind : order) {
+        if (ind >= n_row * n_col || ca_curr->cell(ind / n_col + 1, ind % n_col + 1).get_state() == 0) {
+            break;
+        }
+        live_cells->insert(ind);
+    }
+    if (live_cells->size() != n_live || order.size() != n_live) {
+        std::cerr << "restore_live_cells(): Error, the checkpoint does not list the live cells" << std::endl;
+        exit(-1);
+    }
+}
+
+/* Open an output file (name.csv or name.bin, see time-series.hpp), or
+   when resuming, the file of the interrupted run cut back to its size at
+   the checkpoint */
+template <class Model> void Simulation<Model>::openOutput(TimeSeriesWriter& outFile, const std::string& name, const std::string& columns, const std::string& types, const CheckpointReader* resume, const std::string& section) {
+    TimeSeriesWriter::Format format = (config.series == "bin") ? TimeSeriesWriter::BINARY : TimeSeriesWriter::CSV;
+    std::string filename = output_path(name + ((format == TimeSeriesWriter::BINARY) ? ".bin" : ".csv"));
+    if (resume) {
+        std::uint64_t size = resume->get_value<std::uint64_t>(section);
+        struct stat info;
+        if (stat(filename.c_str(), &info) != 0 || static_cast<std::uint64_t>(info.st_size) < size || truncate(filename.c_str(), size) != 0) {
+            std::cerr << "openOutput(): Error, " << filename << " does not hold the output up to the checkpoint" << std::endl;
+            exit(-1);
+        }
+    }
+    outFile.open(filename, columns, types, format, resume != nullptr);
+}
+
+// Average public goods concentration around (row,col), looked up in the maintained field
+template <class Model> template <class RNG> double Simulation<Model>::average_k_at(Local, unsigned row, unsigned col, RNG&) {
+    double average_k = pg_field->average_k(row, col);
+    try {
+        Assert<GeneralError>(!ASSERT::ERROR_CHECK || std::fabs(average_k - ca_curr->cell(row, col).cal_average_k(ca_curr, row, col, config.radius)) < pg_field->tolerance());
+    } catch (GeneralError) {
+        std::cerr << "average_k_at(): Error, public goods field is out of sync at (" << row << ", " << col << ")" << std::endl;
+        exit(-1);
+    }
+    return average_k;
+}
+
+/* Public goods concentration perceived by a cell of a well-mixed
+   population: the mean k of the live cells, wherever they are, found
+   as set by mean_k_mode (see model-policies.hpp). The samples are drawn
+   from rng. */
+template <class Model> template <class RNG> double Simulation<Model>::average_k_at(WellMixed, unsigned, unsigned, RNG& rng) {
+    switch (mean_k_mode) {
+        case WellMixed::EXACT:
+            return state_stats->mean_k(1, 4);
+        case WellMixed::LIVE_SAMPLE: {
+            if (live_cells->size() == 0) {
+                return 0.0;
+            }
+            double total_k = 0.0;
+            for (unsigned i = 0; i < WellMixed::N_SAMPLE; ++i) {
+                unsigned ind = live_cells->pick(rng);
+                total_k += ca_curr->cell(ind / n_col + 1, ind % n_col + 1).get_k();
+            }
+            return total_k / WellMixed::N_SAMPLE;
+        }
+        default: {
+            std::uniform_int_distribution<unsigned> dist_row(1, n_row);
+            std::uniform_int_distribution<unsigned> dist_col(1, n_col);
+            double total_k = 0.0;
+            unsigned n_alive = 0;
+            for (unsigned i = 0; i < WellMixed::N_SAMPLE; ++i) {
+                unsigned sample_row = dist_row(rng);
+                unsigned sample_col = dist_col(rng);
+                auto&& sample = ca_curr->cell(sample_row, sample_col);
+                if (sample.get_state() != 0) {
+                    total_k += sample.get_k();
+                    n_alive += 1;
+                }
+            }
+            return n_alive > 0 ? total_k / n_alive : 0.0;
+        }
+    }
+}
+
+/* The parent of an offspring at the empty cell (row,col): its nei-th
+   neighbor. Returns whether it is alive. */
+template <class Model> template <class RNG> bool Simulation<Model>::draw_parent(Local, unsigned row, unsigned col, unsigned nei, RNG&, unsigned& neirow, unsigned& neicol) {
+    if (ca_curr->cell(ca_curr->index_near(row,col,nei)).get_state() == 0) {
+        return false;
+    }
+    ca_curr->xy_neigh_wrap(row,col,nei,neirow,neicol);
+    return true;
+}
+
+// Reproduction is no longer just within the neighbourhood: the parent is drawn from rng anywhere on the grid
+template <class Model> template <class RNG> bool Simulation<Model>::draw_parent(WellMixed, unsigned, unsigned, unsigned, RNG& rng, unsigned& neirow, unsigned& neicol) {
+    std::uniform_int_distribution<unsigned> dist_row(1, n_row);
+    std::uniform_int_distribution<unsigned> dist_col(1, n_col);
+    neirow = dist_row(rng);
+    neicol = dist_col(rng);
+    return ca_curr->cell(neirow, neicol).get_state() != 0;
+}
+
+/* Public goods provided to the cell at (row,col) by the others of its
+   neighborhood of radius config.radius: by the DOL system in k_sum[0]
+   and by system p in k_sum[1], found by a scan. Returns the total,
+   summed in the order of the scan. It is the reference for system_k(). */
+template <class Model> double Simulation<Model>::neighbor_k(unsigned row, unsigned col, double k_sum[2]) {
+    const int radius = config.radius;
+    double total_k = 0.0;
+    k_sum[0] = k_sum[1] = 0.0;
+    for (int r = static_cast<int>(row) - radius; r <= static_cast<int>(row) + radius; ++r) {
+        unsigned wrapped_r = ca_curr->wrap_row(r);
+        for (int c = static_cast<int>(col) - radius; c <= static_cast<int>(col) + radius; ++c) {
+            unsigned wrapped_c = ca_curr->wrap_col(c);
+            // Skip Centre Cell
+            if (wrapped_r == row && wrapped_c == col) {
+                continue;
+            }
+            auto&& neighbor = ca_curr->cell(wrapped_r, wrapped_c);
+            if (neighbor.get_state() != 0) {
+                k_sum[(neighbor.get_state() <= 2) ? 0 : 1] += neighbor.get_k();
+                total_k += neighbor.get_k();
+            }
+        }
+    }
+    return total_k;
+}
+
+/* Same as neighbor_k(), looked up in the fields kept per system. A
+   debug build checks the lookup against the scan. A sum holds up to
+   one k per cell of the neighborhood, so it may differ by the
+   tolerance of an average times their number. */
+template <class Model> double Simulation<Model>::system_k(unsigned row, unsigned col, double k_sum[2]) {
+    k_sum[0] = dol_k->get_k_sum(row, col);
+    k_sum[1] = p_k->get_k_sum(row, col);
+    if (ASSERT::ERROR_CHECK) {
+        double scan[2];
+        neighbor_k(row, col, scan);
+        const double sum_tolerance = dol_k->tolerance() * (2 * config.radius + 1) * (2 * config.radius + 1);
+        try {
+            Assert<GeneralError>(std::fabs(k_sum[0] - scan[0]) < sum_tolerance
+                                 && std::fabs(k_sum[1] - scan[1]) < sum_tolerance);
+        } catch (GeneralError) {
+            std::cerr << "system_k(): Error, the k fields of the systems are out of sync at (" << row << ", " << col << ")" << std::endl;
+            exit(-1);
+        }
+    }
+    return k_sum[0] + k_sum[1];
+}
+
+/* Share of the DOL system (system 0) or of system p (system 1) in the
+   public goods provided to the cell at (row,col) by the others of its
+   neighborhood, 0 when none of them produces any */
+template <class Model> double Simulation<Model>::contribution_share(unsigned row, unsigned col, unsigned system) {
+    double k_sum[2];
+    double total_k = system_k(row, col, k_sum);
+    return (total_k == 0.0) ? 0.0 : k_sum[system] / total_k;
+}
+
+/* A birth from the parent at (row,col): the share of the other system
+   in the public goods around the parent is added to its contribution */
+template <class Model> void Simulation<Model>::count_contribution(unsigned row, unsigned col) {
+    unsigned system = (ca_curr->cell(row, col).get_state() <= 2) ? 0 : 1;
+    ++n_births[system];
+    contribution[1 - system] += contribution_share(row, col, 1 - system);
+}
+
+/* Total rate of the events started by the cell at (row,col) in the
+   exact engine: death, move, and one birth for every empty neighbor,
+   each at rate average_k*(1-k)/8. */
+template <class Model> double Simulation<Model>::propensity(unsigned row, unsigned col) {
+    auto&& cell = ca_curr->cell(row, col);
+    if (cell.get_state() == 0) {
+        return 0.0;
+    }
+    unsigned n_empty = 0;
+    for (unsigned nei = 1; nei <= 8; ++nei) {
+        if (ca_curr->cell(ca_curr->index_near(row, col, nei)).get_state() == 0) {
+            ++n_empty;
+        }
+    }
+    double rate = params.death + params.Move_chance;
+    if (n_empty > 0) {
+        rate += average_k_at(Neighborhood(), row, col, random) * (1 - cell.get_k()) * n_empty / 8.0;
+    }
+    return rate;
+}
+
+/* A change at (row,col) alters the public goods perceived in its
+   neighborhood of radius config.radius (5x5 by default), and the empty
+   neighbors of its 3x3 neighborhood, so the rates of these cells are
+   recomputed. */
+template <class Model> void Simulation<Model>::ssa_refresh(unsigned row, unsigned col) {
+    const int radius = config.radius;
+    for (int r = static_cast<int>(row) - radius; r <= static_cast<int>(row) + radius; ++r) {
+        unsigned wrapped_r = ca_curr->wrap_row(r);
+        for (int c = static_cast<int>(col) - radius; c <= static_cast<int>(col) + radius; ++c) {
+            unsigned wrapped_c = ca_curr->wrap_col(c);
+            ssa_tree->set((wrapped_r - 1) * n_col + (wrapped_c - 1), propensity(wrapped_r, wrapped_c));
+        }
+    }
+}
+
+// Keep the cell at (row,col) in the live-cell index if and only if it is alive
+template <class Model> void Simulation<Model>::track_live(unsigned row, unsigned col) {
+    unsigned ind = (row - 1) * n_col + (col - 1);
+    if (ca_curr->cell(row, col).get_state() != 0) {
+        live_cells->insert(ind);
+    } else {
+        live_cells->erase(ind);
+    }
+}
+
+// Rebuild the live-cell index from the grid
+template <class Model> void Simulation<Model>::rebuild_live_cells() {
+    live_cells->clear();
+    for (unsigned row = 1; row <= n_row; ++row) {
+        for (unsigned col = 1; col <= n_col; ++col) {
+            track_live(row, col);
+        }
+    }
+}
+
+// Register the cell at (row,col) in the population statistics
+template <class Model> void Simulation<Model>::count_cell(unsigned row, unsigned col) {
+    state_stats->refresh(*ca_curr, row, col);
+    if (ancestor_stats) {
+        ancestor_stats->refresh(*ca_curr, row, col);
+    }
+}
+
+// Recompute the population statistics by a scan of the grid
+template <class Model> void Simulation<Model>::rescan_stats() {
+    state_stats->rebuild(*ca_curr);
+    if (ancestor_stats) {
+        ancestor_stats->rebuild(*ca_curr);
+    }
+}
+
+// Tell the maintained structures that the cell at (row,col) may have changed
+template <class Model> void Simulation<Model>::cell_changed(unsigned row, unsigned col) {
+    ca_curr->mirror(row, col);
+    if (Neighborhood::LOCAL) {
+        pg_field->refresh(*ca_curr, row, col);
+    }
+    if (Neighborhood::CONTRIBUTIONS) {
+        dol_k->refresh(*ca_curr, row, col);
+        p_k->refresh(*ca_curr, row, col);
+    }
+    // The threads of the parallel engine cannot share the index and the statistics
+    if (!tiles) {
+        if (live_cells) {
+            track_live(row, col);
+        }
+        count_cell(row, col);
+    }
+    if (active_sites) {
+        active_sites->refresh(*ca_curr, row, col);
+    }
+    if (ssa_tree) {
+        ssa_refresh(row, col);
+    }
+}
+
+/* Same as cell_changed() for the two cells of a swap. The rates can only
+   be recomputed once both cells are registered. */
+template <class Model> void Simulation<Model>::cells_swapped(unsigned row, unsigned col, unsigned row2, unsigned col2) {
+    ca_curr->mirror(row, col);
+    ca_curr->mirror(row2, col2);
+    if (Neighborhood::LOCAL) {
+        pg_field->refresh(*ca_curr, row, col);
+        pg_field->refresh(*ca_curr, row2, col2);
+    }
+    if (Neighborhood::CONTRIBUTIONS) {
+        dol_k->refresh(*ca_curr, row, col);
+        dol_k->refresh(*ca_curr, row2, col2);
+        p_k->refresh(*ca_curr, row, col);
+        p_k->refresh(*ca_curr, row2, col2);
+    }
+    if (!tiles) {
+        if (live_cells) {
+            track_live(row, col);
+            track_live(row2, col2);
+        }
+        count_cell(row, col);
+        count_cell(row2, col2);
+    }
+    if (active_sites) {
+        active_sites->refresh(*ca_curr, row, col);
+        active_sites->refresh(*ca_curr, row2, col2);
+    }
+    if (ssa_tree) {
+        ssa_refresh(row, col);
+        ssa_refresh(row2, col2);
+    }
+}
+
+/* Start loading what an update drawn at (row,col) with neighbor nei
+   reads first: the cell, its neighbor and, when the public goods are
+   local, those around the neighbor. */
+template <class Model> void Simulation<Model>::prefetch_draw(unsigned row, unsigned col, unsigned nei) {
+    unsigned neirow = 0;
+    unsigned neicol = 0;
+    ca_curr->xy_neigh_wrap(row, col, nei, neirow, neicol);
+    ca_curr->prefetch(ca_curr->index(row, col));
+    ca_curr->prefetch(ca_curr->index(neirow, neicol));
+    if (Neighborhood::LOCAL) {
+        pg_field->prefetch(neirow, neicol);
+    }
+}
+
+// The cell at (row,col) dies
+template <class Model> void Simulation<Model>::kill_cell(unsigned row, unsigned col) {
+    ca_curr->cell(row, col).set_state(0);
+    cell_changed(row, col);
+}
+
+// The cell at (row,col) swaps its place with its nei-th neighbor
+template <class Model> void Simulation<Model>::move_cell(unsigned row, unsigned col, unsigned nei) {
+    unsigned random_row = 0;
+    unsigned random_col = 0;
+    ca_curr->xy_neigh_wrap(row,col,nei,random_row,random_col);
+    swap(ca_curr->cell(row,col),ca_curr->cell(random_row,random_col));
+    cells_swapped(row, col, random_row, random_col);
+}
+
+/* The empty cell at (row,col) receives an offspring of the given state
+   from the cell at (neirow,neicol). M: mutation rate. Cells of system p
+   do not differentiate. rng: the random number generator */
+template <class Model> template <class RNG> void Simulation<Model>::birth_cell(unsigned row, unsigned col, unsigned neirow, unsigned neicol, unsigned state, double M, RNG& rng) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    if (Neighborhood::CONTRIBUTIONS) {
+        count_contribution(neirow, neicol);
+    }
+    auto&& parent = ca_curr->cell(neirow, neicol);
+    ca_curr->cell(row, col).set_state(state);
+    if (M > uniform(rng))
+    {
+        // The four deviates are drawn in this order
+        std::normal_distribution<double> dist(0.0, Mutation::var);
+        double da = Mutation::mutate(parent.get_da(), dist(rng));
+        double ka = Mutation::mutate(parent.get_ka(), dist(rng));
+        double db = Mutation::mutate(parent.get_db(), dist(rng));
+        double kb = Mutation::mutate(parent.get_kb(), dist(rng));
+        ca_curr->cell(row,col).set_keep(da, ka, db, kb);
+    }
+    else
+    {
+        ca_curr->cell(row,col).set_keep(parent.get_da(),parent.get_ka(),parent.get_db(),parent.get_kb());
+    }
+    if (Systems::LINEAGE) {
+        ca_curr->cell(row,col).set_ances(parent.get_ances());
+    }
+    if (state == 3 || state == 4) {
+        ca_curr->cell(row,col).set_d(0,0);
+    }
+    cell_changed(row, col);
+}
+
+/* One update of the cell at (row,col), as drawn by the sweep: a live
+   cell may die or move to a random neighboring cell, an empty cell may
+   receive the offspring of a parent drawn as set by the Neighborhood
+   policy. p: the probability drawn for the update, nei: the neighbor
+   drawn for it (1 to 8), rng: the random number generator for the rest */
+template <class Model> template <class RNG> void Simulation<Model>::update_site(unsigned row, unsigned col, double p, unsigned nei, double mutation, RNG& rng) {
+    //Automatons' parameter update
+    switch (ca_curr->cell(row, col).get_state()) {
+        // The cells of both systems die and move alike
+        case 1:
+        case 2:
+        case 3:
+        case 4:{
+            if ((params.death)*t > p)
+            {
+                kill_cell(row, col);
+            }
+            //Automatons move randomly
+            else if ((params.Move_chance+params.death)*t > p)
+                {
+                    move_cell(row, col, nei);
+                }
+            break;
+        }
+        /*
+        If the parent drawn for the empty cell is alive, the average
+        concentration of common property it perceives is used to calculate
+        whether to produce offspring at that location.
+        */
+        case 0:{
+                double M = mutation;//mutation rate
+                unsigned neirow = 0;
+                unsigned neicol = 0;
+                //A living parent produces offspring at this location
+                if (draw_parent(Neighborhood(), row, col, nei, rng, neirow, neicol))
+                {
+                    double average_k = average_k_at(Neighborhood(), neirow, neicol, rng);
+                    switch (ca_curr->cell(neirow,neicol).get_state())
+                    {
+                        case 1:{
+                            if ((average_k*(1-ca_curr->cell(neirow,neicol).get_ka())*ca_curr->cell(neirow,neicol).get_da())*t > p)
+                            {
+                                birth_cell(row, col, neirow, neicol, 2, M, rng);
+                            }
+                            //if ((average_k*(1-ca_curr->cell(neirow,neicol).get_ka()))*d > p && p >= (average_k*(1-ca_curr->cell(neirow,neicol).get_ka())*ca_curr->cell(neirow,neicol).get_da())*d)
+                            else if ((average_k*(1-ca_curr->cell(neirow,neicol).get_ka()))*t > p )
+                            {
+                                birth_cell(row, col, neirow, neicol, 1, M, rng);
+                            }
+                            break;
+                        }
+                        case 2:{
+                            if ((average_k*(1-ca_curr->cell(neirow,neicol).get_kb())*ca_curr->cell(neirow,neicol).get_db())*t > p )
+                            {
+                                birth_cell(row, col, neirow, neicol, 1, M, rng);
+                            }
+                            //if ((average_k*(1-ca_curr->cell(neirow,neicol).get_kb()))*d > p && p >= (average_k*(1-ca_curr->cell(neirow,neicol).get_kb())*ca_curr->cell(neirow,neicol).get_db())*d)
+                            else if ((average_k*(1-ca_curr->cell(neirow,neicol).get_kb()))*t > p )
+                            {
+                                birth_cell(row, col, neirow, neicol, 2, M, rng);
+                            }
+                            break;
+                        }
+                        // System p does not differentiate
+                        case 3:{
+                            if ((average_k*(1-ca_curr->cell(neirow,neicol).get_ka()))*t > p )
+                            {
+                                birth_cell(row, col, neirow, neicol, 3, M, rng);
+                            }
+                            break;
+                        }
+                        case 4:{
+                            if ((average_k*(1-ca_curr->cell(neirow,neicol).get_kb()))*t > p )
+                            {
+                                birth_cell(row, col, neirow, neicol, 4, M, rng);
+                            }
+                            break;
+                        }
+
+                    }
+
+
+                }
+            break;
+        }
+    }
+}
+
+// Same as above, with p and nei drawn from rng
+template <class Model> template <class RNG> void Simulation<Model>::update_site(unsigned row, unsigned col, double mutation, RNG& rng) {
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    std::uniform_int_distribution<unsigned> dist_8(1, 8);
+    double p = uniform(rng);
+    unsigned nei = dist_8(rng);
+    update_site(row, col, p, nei, mutation, rng);
+}
+
+/* Same dynamics as n_draws updates of the sweep, but only the active
+   sites are drawn. A draw on an inactive site changes nothing, so the
+   number of such draws before the next active one is geometric, with
+   success probability (active sites)/(all sites), and is skipped at
+   once. It is drawn again after every update since the active sites
+   may have changed. */
+template <class Model> void Simulation<Model>::sweep_active(unsigned long n_draws, double mutation) {
+    const double n_sites = static_cast<double>(n_row) * n_col;
+    while (active_sites->size() > 0) {
+        unsigned long n_skip = 0;
+        if (active_sites->size() < n_sites) {
+            std::geometric_distribution<unsigned long> dist_skip(active_sites->size() / n_sites);
+            n_skip = dist_skip(random);
+        }
+        if (n_skip >= n_draws) {
+            break;
+        }
+        n_draws -= n_skip + 1;
+        unsigned row, col;
+        active_sites->pick(random, row, col);
+        update_site(row, col, mutation, random);
+    }
+}
+
+// State of an offspring of the cell at (row,col) in the exact engine
+template <class Model> unsigned Simulation<Model>::offspring_state(unsigned row, unsigned col) {
+    auto&& parent = ca_curr->cell(row, col);
+    switch (parent.get_state()) {
+        case 1:
+            return (uniform(random) < parent.get_da()) ? 2 : 1;
+        case 2:
+            return (uniform(random) < parent.get_db()) ? 1 : 2;
+        default:
+            return parent.get_state();
+    }
+}
+/* Exact stochastic simulation (Gillespie's direct method) of the
+   continuous-time limit of the sweep during the given time. The cell
+   starting the next event is chosen in proportion to its rate, then
+   the event among its death, move and births. Every cell is drawn
+   once per unit of time in the sweep, so an event of probability
+   x*t per draw has rate x here. */
+template <class Model> void Simulation<Model>::ssa_advance(double duration, double mutation) {
+    std::uniform_int_distribution<unsigned> dist_8(1, 8);
+    std::exponential_distribution<double> dist_wait(1.0);
+    double clock = 0.0;
+    while (ssa_tree->total() > 0.0) {
+        clock += dist_wait(random) / ssa_tree->total();
+        if (clock >= duration) {
+            break;
+        }
+        unsigned ind = ssa_tree->find(uniform(random) * ssa_tree->total());
+        unsigned row = ind / n_col + 1;
+        unsigned col = ind % n_col + 1;
+        double rate = ssa_tree->get(ind);
+        try {
+            Assert<GeneralError>(!ASSERT::ERROR_CHECK || std::fabs(rate - propensity(row, col)) < 1e-12);
+        } catch (GeneralError) {
+            std::cerr << "ssa_advance(): Error, stale rate at (" << row << ", " << col << ")" << std::endl;
+            exit(-1);
+        }
+
+        double u = uniform(random) * rate;
+        if (u < params.death) {
+            kill_cell(row, col);
+        } else if (u < params.death + params.Move_chance) {
+            move_cell(row, col, dist_8(random));
+        } else {
+            // Offspring go to one of the empty neighbors
+            unsigned empty[8];
+            unsigned n_empty = 0;
+            for (unsigned nei = 1; nei <= 8; ++nei) {
+                if (ca_curr->cell(ca_curr->index_near(row, col, nei)).get_state() == 0) {
+                    empty[n_empty++] = nei;
+                }
+            }
+            std::uniform_int_distribution<unsigned> dist_empty(0, n_empty - 1);
+            unsigned birthrow = 0;
+            unsigned birthcol = 0;
+            ca_curr->xy_neigh_wrap(row, col, empty[dist_empty(random)], birthrow, birthcol);
+            birth_cell(birthrow, birthcol, row, col, offspring_state(row, col), mutation, random);
+        }
+    }
+}
+
+/* Parallel engine: the same dynamics as a sweep, with the torus cut
+   into tiles (see TileSchedule). The tiles of one color are updated at
+   the same time, one color after the other, in an order drawn at every
+   step. Every tile draws as many random sites inside itself as it has
+   cells, with its own stream of random numbers, so for a given seed and
+   tile side the result does not depend on the number of threads. */
+template <class Model> void Simulation<Model>::sweep_tiles(unsigned long step, std::uint64_t seed, double mutation) {
+    const std::uint64_t first_stream = 1 + step * (tiles->size() + 1);
+    CounterRng order_rng(seed, first_stream);
+    unsigned colors[4] = {0, 1, 2, 3};
+    std::shuffle(colors, colors + 4, order_rng);
+    for (unsigned color : colors) {
+        const std::vector<unsigned>& members = tiles->of_color(color);
+        #pragma omp parallel for schedule(dynamic)
+        for (long i = 0; i < static_cast<long>(members.size()); ++i) {
+            const unsigned tile = members[i];
+            CounterRng rng(seed, first_stream + 1 + tile);
+            SweepDraws draws;
+            draws.start(rng, tiles->area(tile), tiles->last_row(tile) - tiles->first_row(tile) + 1, tiles->last_col(tile) - tiles->first_col(tile) + 1);
+            while (const std::size_t n_draws = draws.next_block()) {
+                for (std::size_t draw = 0; draw < n_draws; ++draw) {
+                    unsigned row = tiles->first_row(tile) - 1 + draws.row(draw);
+                    unsigned col = tiles->first_col(tile) - 1 + draws.col(draw);
+                    update_site(row, col, draws.p(draw), draws.nei(draw), mutation, rng);
+                }
+            }
+        }
+    }
+}
+
+// Color of the cell at (row,col) in the movie frames, by its type and its k
+template <class Model> unsigned char Simulation<Model>::cell_color(OneSystem, int row, int col) {
+    unsigned char color = CashColor::BLACK;
+    switch (ca_curr->cell(row, col).get_state()) {
+        case 0: // Dead state
+            color = CashColor::BLACK;
+            break;
+        case 1: // Bacteria A
+            if (ca_curr->cell(row, col).get_ka() < 0.2) {
+                color = CashColor::YELLOW;
+                }
+            else if (ca_curr->cell(row, col).get_ka()> 0.8) {
+                color = CashColor::WHITE;
+                }
+            else{
+               color = CashColor::RED;
+            }
+             break;
+        case 2: // Bacteria B
+            if (ca_curr->cell(row, col).get_kb() < 0.2) {
+                color = CashColor::VIOLET;
+                }
+            else if (ca_curr->cell(row, col).get_kb() > 0.8) {
+                color = CashColor::BLUE;
+                }
+            else{
+               color = CashColor::GRAY;
+            }
+             break;
+        }
+    return color;
+}
+
+/* Color of the cell at (row,col) in the movie frames. State 1 or 2
+   represents bacteria type a or b in the DOL system, while state 3 or 4
+   represents bacteria type a or b in system p. However, only one of
+   states 3 or 4 can exist in a single simulation at a time. */
+template <class Model> unsigned char Simulation<Model>::cell_color(TwoSystems, int row, int col) {
+    unsigned char color = CashColor::BLACK;
+    switch (ca_curr->cell(row, col).get_state()) {
+        case 0:
+            color = CashColor::BLACK;
+            break;
+        case 1:
+            color = CashColor::RED;
+            break;
+        case 2:
+            color = CashColor::GREEN;
+            break;
+        case 3:
+            color = CashColor::BLUE;
+            break;
+        case 4:
+            color = CashColor::CYAN;
+            break;
+    }
+    return color;
+}
+
+/* Write the counts of the ancestor tags, and once the descendants of
+   one of the types are all gone, tag every cell anew with its type */
+template <class Model> void Simulation<Model>::write_lineage() {
+    unsigned num1 = ancestor_stats->count(1);
+    unsigned num2 = ancestor_stats->count(2);
+    ancestorOutFile << time*t << num1 << num2;
+    if (num1 == 0 || num2 == 0)
+            {
+                for (unsigned row = 1; row <= n_row; ++row) {
+                    for (unsigned col = 1; col <= n_col; ++col) {
+                    if (ca_curr->cell(row, col).get_state() != 0){
+                        ca_curr->cell(row, col).set_ances(ca_curr->cell(row, col).get_state());
+                        }
+                    }
+                }
+                ancestor_stats->rebuild(*ca_curr);
+            }
+}
+
+// Write the averages and the counts of the two types
+template <class Model> void Simulation<Model>::write_cells(OneSystem) {
+    unsigned totalCount = state_stats->count(1) + state_stats->count(2);
+    cellOutFile << time*t << state_stats->mean_k(1) << state_stats->mean_d(1)
+            << state_stats->mean_k(2) << state_stats->mean_d(2)
+            << state_stats->count(1) << state_stats->count(2) << totalCount;
+}
+
+/* Write the averages and the counts of the four states, and with the
+   contributions the public goods that every system receives from
+   itself and from the other one: K12 is the average over the cells of
+   system p of the k of the DOL system around them, divided by both
+   populations, and so on. */
+template <class Model> void Simulation<Model>::write_cells(TwoSystems) {
+    // Calculate the total count of states
+    unsigned totalCount1 = state_stats->count(1) + state_stats->count(2);
+    unsigned totalCount2 = state_stats->count(3) + state_stats->count(4);
+    cellOutFile << time << state_stats->mean_k(1) << state_stats->mean_d(1)
+            << state_stats->mean_k(2) << state_stats->mean_d(2) << state_stats->mean_k(3) << state_stats->mean_d(3)
+            << state_stats->mean_k(4) << state_stats->mean_d(4)
+            << state_stats->count(1) << state_stats->count(2) << state_stats->count(3) << state_stats->count(4)
+            << totalCount1 << totalCount2;
+    if (Neighborhood::CONTRIBUTIONS) {
+        // The contributions depend on the neighbors of every cell, so they are summed over the grid, one lookup per cell
+        double K21 = 0, K11 = 0, K12 = 0, K22 = 0;
+        double k_sum[2];
+        for (unsigned row = 1; row <= n_row; ++row) {
+            for (unsigned col = 1; col <= n_col; ++col) {
+                auto&& cell = ca_curr->cell(row, col);
+                if (cell.get_state() == 1 || cell.get_state() == 2) {
+                    system_k(row, col, k_sum);
+                    K11 += k_sum[0];
+                    K21 += k_sum[1];
+                }
+                else if (cell.get_state() == 3 || cell.get_state() == 4) {
+                    system_k(row, col, k_sum);
+                    K12 += k_sum[0];
+                    K22 += k_sum[1];
+                }
+            }
+        }
+
+        // The products of the counts are taken in double, they overflow an unsigned above 65535 cells
+        K11 /= (double(totalCount1)*totalCount1);
+        K21 /= (double(totalCount1)*totalCount2);
+        K12 /= (double(totalCount1)*totalCount2);
+        K22 /= (double(totalCount2)*totalCount2);
+        cellOutFile << K21 << K11 << K12 << K22;
+    }
+}
+
+/* Write the average contribution of each system to the births of the
+   other one during the step, 0 when the other one had none */
+template <class Model> void Simulation<Model>::write_contributions() {
+    double Total1Avgcon = (n_births[1] > 0) ? contribution[0] / n_births[1] : 0.0;
+    double Total2Avgcon = (n_births[0] > 0) ? contribution[1] / n_births[0] : 0.0;
+    contributionOutFile << time << Total1Avgcon << Total2Avgcon;
+}
+
+// Every cell of the box dies
+template <class Model> void Simulation<Model>::perturb(BoxKill) {
+    for (unsigned row = box[0]; row <= box[2]; ++row) {
+        for (unsigned col = box[1]; col <= box[3]; ++col) {
+            if (ca_curr->cell(row, col).get_state() != 0) {
+                ca_curr->cell(row,col).set_state(0);
+                cell_changed(row, col);
+            }
+        }
+    }
+}
+
+// A fraction of the live cells, drawn at random, die
+template <class Model> void Simulation<Model>::perturb(RandomKill) {
+    std::cout << "kill cells" <<std::endl;
+    // The parallel engine does not maintain the index during the steps
+    if (tiles) {
+        rebuild_live_cells();
+    }
+    unsigned livingCells = live_cells->size();
+    unsigned cellsToKill = static_cast<unsigned>(livingCells * RandomKill::FRACTION);
+    /* Partial Fisher-Yates selection: every victim is drawn uniformly
+       among the cells still alive, and erasing it from the index moves
+       the last live cell into its place. The erase is explicit since
+       cell_changed() skips the index under the parallel engine. */
+    for (unsigned killedCells = 0; killedCells < cellsToKill; ++killedCells) {
+        unsigned ind = live_cells->pick(random);
+        live_cells->erase(ind);
+        kill_cell(ind / n_col + 1, ind % n_col + 1);
+    }
+}
+
+template <class Model> typename Simulation<Model>::Status Simulation<Model>::run()
+{
+#ifdef _OPENMP
+    // The number of threads is a setting of the calling thread
+    if (tiles && config.n_threads > 0) {
+        omp_set_num_threads(config.n_threads);
+    }
+#endif
+
+    //killing time
+    unsigned nextKillTime = Perturbation::INTERVAL / t;
+
+    /* Update the CA & display */
+    unsigned max_time = config.runtime / t;
+    Status status = FINISHED;
+    for (time = start_time; time < max_time; ++time) {
+        /* The state at the start of this step, from which the run can be
+           resumed: every checkpoint_every steps, when a signal asks for it
+           and before stopping at the end of the wall clock budget. */
+        if (config.max_wall_seconds > 0 && std::chrono::steady_clock::now() >= config.wall_deadline) {
+            stop_requested = true;
+        }
+        unsigned requests = checkpoint_requests;
+        if (time != start_time && ((config.checkpoint_every > 0 && time % config.checkpoint_every == 0) || requests != checkpoints_seen || stop_requested)) {
+            checkpoints_seen = requests;
+            cellOutFile.flush();
+            ancestorOutFile.flush();
+            contributionOutFile.flush();
+            saveCheckpoint(output_path("checkpoint.ckp"));
+            if (stop_requested) {
+                status = STOPPED;
+                break;
+            }
+        }
+
+        /* The trait sums are recomputed from time to time, which cancels
+           their rounding errors. The parallel engine does not update the
+           statistics during its steps, so they are also recomputed before
+           they are written, and extinction is only detected then. */
+        if (time % config.rescan_interval == 0 || (tiles && time % Systems::OUTPUT_INTERVAL == 0)) {
+            rescan_stats();
+        }
+
+        //check ancestor state
+        if (Systems::LINEAGE && time % Systems::OUTPUT_INTERVAL == 0) {
+            write_lineage();
+        }
+
+        //kill cells (see model-policies.hpp)
+        if (Perturbation::KILLS && time >= lastKillTime + nextKillTime) {
+            perturb(Perturbation());
+            // cell_changed() leaves the statistics to the scans under the parallel engine
+            if (tiles) {
+                rescan_stats();
+            }
+            //nextKillTime = static_cast<unsigned>(runtime / (10 + time / (max_time / 5)));
+            lastKillTime = time;
+        }
+
+        if (time % Systems::OUTPUT_INTERVAL == 0) {
+            write_cells(Systems());
+        }
+
+        if (Systems::extinct(*state_stats)) {
+            status = EXTINCT;
+            break;
+        }
+
+        /* If PNG slides are needed, draw things */
+        if (display_p && time % movie_interval == 0) {
+            if (config.movie == "mov")
+                display_p->draw_movie();
+            else
+                display_p->draw_png();
+        }
+
+        // The contributions are summed over the births of a step
+        if (Neighborhood::CONTRIBUTIONS) {
+            contribution[0] = contribution[1] = 0.0;
+            n_births[0] = n_births[1] = 0;
+        }
+
+        if (tiles) {
+            //Tiles far enough apart are updated by different threads
+            sweep_tiles(time, config.seed, config.mutation);
+        } else if (ssa_tree) {
+            //Events in continuous time during this time step
+            ssa_advance(t, config.mutation);
+        } else if (active_sites) {
+            //Only the sites where something can happen are drawn
+            sweep_active(n_row*n_col, config.mutation);
+        } else {
+            //The current location is randomly selected, the number of rows multiplied by the number of columns
+            draws.start(random, n_row*n_col, n_row, n_col);
+            while (const std::size_t n_draws = draws.next_block()) {
+                for (std::size_t i = 0; i < n_draws; ++i) {
+                    /* The sites of a block are drawn in advance, so the
+                       cells of a later draw can be loaded while this one
+                       is updated. The updates still run one after the
+                       other, in order. */
+                    if (config.prefetch > 0 && i + config.prefetch < n_draws) {
+                        const std::size_t ahead = i + config.prefetch;
+                        prefetch_draw(draws.row(ahead), draws.col(ahead), draws.nei(ahead));
+                    }
+                    //Pick a location at random
+                    unsigned row = draws.row(i);
+                    unsigned col = draws.col(i);
+                    update_site(row, col, draws.p(i), draws.nei(i), config.mutation, random);
+                }
+            }
+        }
+
+        if (Neighborhood::CONTRIBUTIONS) {
+            write_contributions();
+        }
+
+    }
+    // Save the current state of all cells
+    saveCellStates(output_path("cell_state_history.txt"), *ca_curr, n_row, n_col);
+    cellOutFile.close();
+    ancestorOutFile.close();
+    contributionOutFile.close();
+    return status;
+}
+
+// The variant of the model built in this folder
+template class Simulation<Model>;